@@ -1,9 +1,16 @@
-QT += core gui sql charts printsupport widgets
+QT += core gui sql charts printsupport widgets concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++11
 
+# 可选：Qt 使用 -system-sqlite 构建时，qmake CONFIG+=system_sqlite 通过 SQLite C API
+# 在连接上注册原生统计聚合函数（scoreaggregates.cpp）；默认不链接 sqlite3
+system_sqlite {
+    DEFINES += SGS_SYSTEM_SQLITE
+    LIBS += -lsqlite3
+}
+
 # 添加Charts模块
 QT += charts
 
@@ -15,12 +22,39 @@ SOURCES += \
     main.cpp \
     mainwindow.cpp \
     databasemanager.cpp \
-    scoremodel.cpp
+    scoremodel.cpp \
+    scorebulkwriter.cpp \
+    csvreader.cpp \
+    importpipeline.cpp \
+    bulkjob.cpp \
+    xlsxreader.cpp \
+    scoresnapshot.cpp \
+    statementcache.cpp \
+    connectionpool.cpp \
+    storageconfig.cpp \
+    dimensionresolver.cpp \
+    schemamigrator.cpp \
+    scoreaggregates.cpp \
+    scoresorter.cpp
 
 HEADERS += \
     mainwindow.h \
     databasemanager.h \
-    scoremodel.h
+    scoremodel.h \
+    scorebulkwriter.h \
+    csvreader.h \
+    importpipeline.h \
+    jobcontrol.h \
+    bulkjob.h \
+    xlsxreader.h \
+    scoresnapshot.h \
+    statementcache.h \
+    connectionpool.h \
+    storageconfig.h \
+    dimensionresolver.h \
+    schemamigrator.h \
+    scoreaggregates.h \
+    scoresorter.h
 
 FORMS += \
     mainwindow.ui
@@ -0,0 +1,21 @@
+# 存储预设基准测试：对每个预设在新建的数据库上运行程序中的典型负载
+# 用法：dbbench [--rows N] [--preset 名称 ...]
+
+QT += core sql
+QT -= gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = dbbench
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    main.cpp \
+    ../../storageconfig.cpp \
+    ../../schemamigrator.cpp
+
+HEADERS += \
+    ../../storageconfig.h \
+    ../../schemamigrator.h
@@ -0,0 +1,345 @@
+#include <QCoreApplication>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QDate>
+#include <QDir>
+#include <functional>
+#include "storageconfig.h"
+#include "schemamigrator.h"
+
+// 对每个存储预设，在临时目录中新建数据库，依次运行与程序相同形状的负载并计时：
+//   批量导入    每5000行一个事务、复用一条预编译INSERT（ScoreBulkWriter）
+//   逐条添加    自动提交的单行INSERT（DatabaseManager::addScore）
+//   筛选查询    班级+课程筛选并按日期排序（getScoresByFilter）
+//   关键字搜索  学号/姓名子串，走 trigram 索引（表格上方的搜索框）；SQLite 不支持 FTS5 时显示为不可用
+//   统计        读取 (班级, 课程) 汇总行（calculateStatistics），
+//               同时运行在成绩表上 COUNT/AVG/MAX/MIN/及格数 扫描的版本作为对照
+//   趋势        读取 (班级, 课程, 日期) 汇总行（getCourseTrendData），
+//               同时运行在成绩表上按考试日期分组扫描的版本、以及改写前的相关子查询版本作为对照
+
+namespace {
+
+const int Courses = 8;
+const int ExamDates = 24;
+const int Classes = 20;
+const char *CourseNames[Courses] = {"语文", "数学", "英语", "物理", "化学", "生物", "历史", "地理"};
+
+QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+bool createSchema(QSqlDatabase &database)
+{
+    // 与程序启动时相同：执行全部结构迁移
+    SchemaMigrator migrator(database);
+    return migrator.migrate();
+}
+
+// 维度表：学生、班级、课程的整数键依次为 1..N
+bool fillDimensions(QSqlDatabase &database, int students)
+{
+    QSqlQuery query(database);
+    database.transaction();
+    query.prepare("INSERT INTO students (id, student_no, name) VALUES (?, ?, ?)");
+    for (int s = 0; s < students; ++s) {
+        query.bindValue(0, s + 1);
+        query.bindValue(1, QString("S%1").arg(s, 7, 10, QChar('0')));
+        query.bindValue(2, QString("学生%1").arg(s));
+        if (!query.exec())
+            return false;
+    }
+    query.prepare("INSERT INTO classes (id, name) VALUES (?, ?)");
+    for (int c = 0; c < Classes; ++c) {
+        query.bindValue(0, c + 1);
+        query.bindValue(1, QString("班级%1").arg(c + 1));
+        if (!query.exec())
+            return false;
+    }
+    query.prepare("INSERT INTO courses (id, name) VALUES (?, ?)");
+    for (int c = 0; c < Courses; ++c) {
+        query.bindValue(0, c + 1);
+        query.bindValue(1, QString::fromUtf8(CourseNames[c]));
+        if (!query.exec())
+            return false;
+    }
+    return database.commit();
+}
+
+// 第 i 行的数据，(学生, 课程, 日期) 在 rows <= 学生数*课程数*日期数 时不重复
+void bindRow(QSqlQuery &query, qint64 i, int students, QRandomGenerator &random)
+{
+    int student = int(i % students);
+    int course = int((i / students) % Courses);
+    int date = int((i / (qint64(students) * Courses)) % ExamDates);
+
+    query.bindValue(0, student + 1);
+    query.bindValue(1, student % Classes + 1);
+    query.bindValue(2, course + 1);
+    query.bindValue(3, 40.0 + random.bounded(6000) / 100.0);
+    query.bindValue(4, QDate(2023, 9, 1).addDays(date * 7).toJulianDay());
+}
+
+double timeMs(const std::function<bool()> &work)
+{
+    QElapsedTimer timer;
+    timer.start();
+    if (!work())
+        return -1.0;
+    return timer.nsecsElapsed() / 1e6;
+}
+
+struct Result {
+    QString preset;
+    double bulkMs = 0;
+    double singleMs = 0;
+    double filterMs = 0;
+    double searchMs = 0;
+    double statsMs = 0;
+    double scanStatsMs = 0;
+    double trendMs = 0;
+    double scanTrendMs = 0;
+    double legacyTrendMs = 0;
+};
+
+// 改写前的 getCourseTrendData：结果的每一行都执行两个相关子查询
+const char *LegacyTrendSql =
+    "SELECT DISTINCT exam_date, "
+    "(SELECT AVG(score) FROM score_facts s2 WHERE s2.exam_date = s1.exam_date "
+    "AND s2.class_key = (SELECT id FROM classes WHERE name = :class_name) "
+    "AND s2.course_key = (SELECT id FROM courses WHERE name = :course)) as avg_score, "
+    "(SELECT COUNT(*) FROM score_facts s3 WHERE s3.exam_date = s1.exam_date "
+    "AND s3.class_key = (SELECT id FROM classes WHERE name = :class_name2) "
+    "AND s3.course_key = (SELECT id FROM courses WHERE name = :course2)) as count "
+    "FROM score_facts s1 WHERE s1.class_key = (SELECT id FROM classes WHERE name = :class_name3) "
+    "AND s1.course_key = (SELECT id FROM courses WHERE name = :course3) "
+    "GROUP BY exam_date ORDER BY exam_date ASC";
+
+// 汇总表之前的 getCourseTrendData：在成绩表上按考试日期分组
+const char *ScanTrendSql =
+    "SELECT exam_date, COUNT(*), AVG(score), MIN(score), MAX(score), SUM(score * score) "
+    "FROM score_facts WHERE class_key = (SELECT id FROM classes WHERE name = :class_name) "
+    "AND course_key = (SELECT id FROM courses WHERE name = :course) "
+    "GROUP BY exam_date ORDER BY exam_date ASC";
+
+// 与 DatabaseManager::getCourseTrendData 相同（班级、课程都已选择时）
+const char *TrendSql =
+    "SELECT exam_date, SUM(count), SUM(total), MIN(min_score), MAX(max_score), SUM(total_squares) "
+    "FROM score_daily_summary WHERE 1=1 "
+    "AND class_key = (SELECT id FROM classes WHERE name = :class_name) "
+    "AND course_key = (SELECT id FROM courses WHERE name = :course) "
+    "GROUP BY exam_date ORDER BY exam_date ASC";
+
+// 汇总表之前的 calculateStatistics：扫描该班级、课程的全部成绩
+const char *ScanStatsSql =
+    "SELECT COUNT(*), AVG(score), MAX(score), MIN(score), "
+    "SUM(CASE WHEN score >= 60 THEN 1 ELSE 0 END) FROM score_facts "
+    "WHERE class_key = (SELECT id FROM classes WHERE name = :class_name) "
+    "AND course_key = (SELECT id FROM courses WHERE name = :course)";
+
+// 与 DatabaseManager::calculateStatistics 相同（班级、课程都已选择时）
+const char *StatsSql =
+    "SELECT SUM(count), SUM(total), SUM(total_squares), MAX(max_score), MIN(min_score), "
+    "SUM(pass_count) FROM score_summary WHERE 1=1 "
+    "AND class_key = (SELECT id FROM classes WHERE name = :class_name) "
+    "AND course_key = (SELECT id FROM courses WHERE name = :course)";
+
+// 依次按不同的班级、课程执行 sql 并读完结果，返回每次的平均耗时；
+// 改写前的趋势查询（legacy）中同一参数出现三次，分别绑定
+double classCourseMs(QSqlDatabase &database, const char *sql, int repeats, bool legacy = false)
+{
+    return timeMs([&]() {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+        if (!query.prepare(sql))
+            return false;
+        for (int r = 0; r < repeats; ++r) {
+            QString className = QString("班级%1").arg(r % Classes + 1);
+            QString course = QString::fromUtf8(CourseNames[r % Courses]);
+            query.bindValue(":class_name", className);
+            query.bindValue(":course", course);
+            if (legacy) {
+                query.bindValue(":class_name2", className);
+                query.bindValue(":class_name3", className);
+                query.bindValue(":course2", course);
+                query.bindValue(":course3", course);
+            }
+            if (!query.exec())
+                return false;
+            while (query.next()) {}
+        }
+        return true;
+    }) / repeats;
+}
+
+Result runPreset(const QString &presetName, qint64 rows, const QString &dir)
+{
+    Result result;
+    result.preset = presetName;
+
+    StorageProfile profile = StorageProfile::preset(presetName);
+    const QString connectionName = "bench_" + presetName;
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        database.setDatabaseName(QDir(dir).filePath(presetName + ".db"));
+        database.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+        if (!database.open() || !profile.apply(database) || !createSchema(database)) {
+            out() << presetName << ": 无法初始化数据库" << Qt::endl;
+            return result;
+        }
+
+        const int students = int(rows / (Courses * ExamDates)) + 1;
+        const int singleRows = 500;
+        const char *insertSql = "INSERT INTO score_facts (student_key, class_key, course_key, score, exam_date) "
+                                "VALUES (?, ?, ?, ?, ?)";
+        QRandomGenerator random(42);
+
+        result.bulkMs = timeMs([&]() {
+            if (!fillDimensions(database, students + singleRows))
+                return false;
+            QSqlQuery insert(database);
+            if (!insert.prepare(insertSql))
+                return false;
+            for (qint64 i = 0; i < rows; i += 5000) {
+                database.transaction();
+                for (qint64 r = i; r < qMin(rows, i + 5000); ++r) {
+                    bindRow(insert, r, students, random);
+                    if (!insert.exec())
+                        return false;
+                }
+                if (!database.commit())
+                    return false;
+            }
+            return true;
+        });
+
+        // 使用批量数据之后的另一段学生，不与已有行冲突
+        result.singleMs = timeMs([&]() {
+            QSqlQuery insert(database);
+            if (!insert.prepare(insertSql))
+                return false;
+            for (int r = 0; r < singleRows; ++r) {
+                bindRow(insert, r, students + singleRows, random);
+                insert.bindValue(0, students + r + 1);
+                if (!insert.exec())
+                    return false;
+            }
+            return true;
+        }) / singleRows;
+
+        const int repeats = 50;
+        result.filterMs = timeMs([&]() {
+            QSqlQuery query(database);
+            query.setForwardOnly(true);
+            query.prepare("SELECT id, student_id, student_name, class_name, course, score, exam_date FROM scores "
+                          "WHERE class_key = (SELECT id FROM classes WHERE name = :class_name) "
+                          "AND course_key = (SELECT id FROM courses WHERE name = :course) ORDER BY exam_date DESC");
+            for (int r = 0; r < repeats; ++r) {
+                query.bindValue(":class_name", QString("班级%1").arg(r % Classes + 1));
+                query.bindValue(":course", QString::fromUtf8(CourseNames[r % Courses]));
+                if (!query.exec())
+                    return false;
+                while (query.next()) {}
+            }
+            return true;
+        }) / repeats;
+
+        bool hasSearchIndex = false;
+        {
+            QSqlQuery check(database);
+            hasSearchIndex = check.exec("SELECT 1 FROM sqlite_master WHERE name = 'student_search'") && check.next();
+        }
+        // SQLite 不支持 FTS5 时迁移不建搜索索引，这一项记为不可用
+        result.searchMs = !hasSearchIndex ? -1.0 : timeMs([&]() {
+            QSqlQuery query(database);
+            query.setForwardOnly(true);
+            query.prepare("SELECT id, student_id, student_name, class_name, course, score, exam_date FROM scores "
+                          "WHERE student_key IN (SELECT rowid FROM student_search WHERE student_search MATCH :keyword) "
+                          "ORDER BY exam_date DESC");
+            for (int r = 0; r < 10; ++r) {
+                // 至少3个字符的关键字走 trigram 索引
+                query.bindValue(":keyword", QString("\"%1\"").arg(1000 + r * 37));
+                if (!query.exec())
+                    return false;
+                while (query.next()) {}
+            }
+            return true;
+        }) / 10;
+
+        result.statsMs = classCourseMs(database, StatsSql, repeats);
+        result.scanStatsMs = classCourseMs(database, ScanStatsSql, repeats);
+        result.trendMs = classCourseMs(database, TrendSql, repeats);
+        result.scanTrendMs = classCourseMs(database, ScanTrendSql, repeats);
+        result.legacyTrendMs = classCourseMs(database, LegacyTrendSql, 5, true);
+
+        database.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return result;
+}
+
+// 耗时列：失败或不可用（记为负数）时显示“不可用”
+QString formatMs(double ms, int width, int precision)
+{
+    return ms < 0 ? QString("%1").arg("不可用", width) : QString("%1").arg(ms, width, 'f', precision);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    qint64 rows = 200000;
+    QStringList presets;
+    const QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        if (args[i] == "--rows" && i + 1 < args.size()) {
+            rows = qMax<qint64>(1, args[++i].toLongLong());
+        } else if (args[i] == "--preset" && i + 1 < args.size()) {
+            presets << args[++i];
+        }
+    }
+    if (presets.isEmpty())
+        presets = StorageProfile::presetNames();
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out() << "无法创建临时目录" << Qt::endl;
+        return 1;
+    }
+
+    out() << "行数: " << rows << Qt::endl;
+    out() << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11")
+                 .arg("预设", -12).arg("批量导入ms", 12).arg("行/秒", 10)
+                 .arg("单行添加ms", 12).arg("筛选ms", 10).arg("搜索ms", 10)
+                 .arg("统计ms", 10).arg("扫描统计ms", 12)
+                 .arg("趋势ms", 10).arg("扫描趋势ms", 12).arg("旧趋势ms", 10)
+          << Qt::endl;
+
+    for (const QString &preset : presets) {
+        Result r = runPreset(preset, rows, dir.path());
+        double rowsPerSecond = r.bulkMs > 0 ? rows * 1000.0 / r.bulkMs : 0.0;
+        out() << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11")
+                     .arg(r.preset, -12)
+                     .arg(formatMs(r.bulkMs, 12, 1))
+                     .arg(rowsPerSecond, 10, 'f', 0)
+                     .arg(formatMs(r.singleMs, 12, 3))
+                     .arg(formatMs(r.filterMs, 10, 2))
+                     .arg(formatMs(r.searchMs, 10, 2))
+                     .arg(formatMs(r.statsMs, 10, 2))
+                     .arg(formatMs(r.scanStatsMs, 12, 2))
+                     .arg(formatMs(r.trendMs, 10, 2))
+                     .arg(formatMs(r.scanTrendMs, 12, 2))
+                     .arg(formatMs(r.legacyTrendMs, 10, 2))
+              << Qt::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "bulkjob.h"
+#include "databasemanager.h"
+#include <QtConcurrent>
+#include <QAtomicInt>
+
+namespace {
+
+// 进度轮询间隔，远大于一帧但足够让状态栏显得连续
+const int ProgressIntervalMs = 200;
+
+QAtomicInt s_jobCounter;
+
+} // namespace
+
+BulkJob::BulkJob(Type type, const QString &filePath, QObject *parent)
+    : QObject(parent)
+    , m_type(type)
+    , m_filePath(filePath)
+{
+    m_progressTimer.setInterval(ProgressIntervalMs);
+    connect(&m_progressTimer, &QTimer::timeout, this, &BulkJob::pollProgress);
+    connect(&m_watcher, &QFutureWatcher<bool>::finished, this, &BulkJob::onWorkerFinished);
+}
+
+BulkJob::~BulkJob()
+{
+    // 窗口关闭时任务可能仍在运行：请求取消并等待工作线程回滚退出
+    if (isRunning()) {
+        m_control.cancel();
+        m_watcher.waitForFinished();
+    }
+}
+
+bool BulkJob::isExport() const
+{
+    return m_type == ExportCsv || m_type == ExportSnapshot;
+}
+
+void BulkJob::setFilter(const QString &className, const QString &course, const QString &keyword)
+{
+    m_className = className;
+    m_course = course;
+    m_keyword = keyword;
+}
+
+void BulkJob::start()
+{
+    if (isRunning())
+        return;
+
+    m_control.reset();
+    m_elapsed.start();
+    m_progressTimer.start();
+    m_watcher.setFuture(QtConcurrent::run([this]() { return runInWorker(); }));
+}
+
+void BulkJob::cancel()
+{
+    m_control.cancel();
+}
+
+bool BulkJob::isRunning() const
+{
+    return m_watcher.isRunning();
+}
+
+BulkJob::Type BulkJob::type() const
+{
+    return m_type;
+}
+
+QString BulkJob::filePath() const
+{
+    return m_filePath;
+}
+
+qint64 BulkJob::rowsDone() const
+{
+    return m_control.rowsDone();
+}
+
+void BulkJob::pollProgress()
+{
+    qint64 rows = m_control.rowsDone();
+    double fraction = m_control.fraction();
+    double seconds = m_elapsed.elapsed() / 1000.0;
+
+    double rowsPerSecond = seconds > 0 ? rows / seconds : 0.0;
+    int etaSeconds = -1;
+    if (fraction > 0.0 && fraction < 1.0) {
+        etaSeconds = int(seconds * (1.0 - fraction) / fraction);
+    } else if (fraction >= 1.0) {
+        etaSeconds = 0;
+    }
+
+    emit progressChanged(rows, rowsPerSecond, etaSeconds, fraction);
+}
+
+void BulkJob::onWorkerFinished()
+{
+    m_progressTimer.stop();
+    pollProgress();
+    bool success = m_watcher.result();
+    emit finished(success, !success && m_control.isCancelled());
+}
+
+bool BulkJob::runInWorker()
+{
+    const QString connectionName = QString("BulkJobConnection_%1").arg(s_jobCounter.fetchAndAddRelaxed(1));
+    DatabaseManager *manager = DatabaseManager::instance();
+
+    bool success = false;
+    {
+        QSqlDatabase database = manager->openWorkerConnection(connectionName);
+        if (database.isOpen()) {
+            switch (m_type) {
+            case ImportCsv:
+                success = manager->importFromCSV(m_filePath, database, &m_control);
+                break;
+            case ImportExcel:
+                success = manager->importFromExcel(m_filePath, database, &m_control);
+                break;
+            case ImportSnapshot:
+                success = manager->importSnapshot(m_filePath, database, &m_control);
+                break;
+            case ExportCsv:
+                success = manager->exportToCSV(m_filePath, m_className, m_course, m_keyword,
+                                               database, &m_control);
+                break;
+            case ExportSnapshot:
+                success = manager->exportSnapshot(m_filePath, database, &m_control);
+                break;
+            }
+        }
+    }
+    DatabaseManager::closeWorkerConnection(connectionName);
+
+    return success;
+}
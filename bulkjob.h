@@ -0,0 +1,63 @@
+#ifndef BULKJOB_H
+#define BULKJOB_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "jobcontrol.h"
+
+// 在后台线程执行的导入/导出任务
+// 工作线程使用自己的数据库连接；界面线程通过定时器轮询进度，不会被大批量数据阻塞
+class BulkJob : public QObject
+{
+    Q_OBJECT
+public:
+    enum Type {
+        ImportCsv,
+        ImportExcel,
+        ImportSnapshot,
+        ExportCsv,
+        ExportSnapshot
+    };
+
+    BulkJob(Type type, const QString &filePath, QObject *parent = nullptr);
+    ~BulkJob();
+
+    bool isExport() const;
+
+    // 导出CSV时使用的班级/课程/关键字筛选（快照总是导出整张表）
+    void setFilter(const QString &className, const QString &course, const QString &keyword);
+
+    void start();
+    void cancel();
+    bool isRunning() const;
+
+    Type type() const;
+    QString filePath() const;
+    qint64 rowsDone() const;
+
+signals:
+    // rowsPerSecond为平均速度，etaSeconds为-1表示暂时无法估算
+    void progressChanged(qint64 rowsDone, double rowsPerSecond, int etaSeconds, double fraction);
+    void finished(bool success, bool cancelled);
+
+private slots:
+    void pollProgress();
+    void onWorkerFinished();
+
+private:
+    bool runInWorker();
+
+    Type m_type;
+    QString m_filePath;
+    QString m_className;
+    QString m_course;
+    QString m_keyword;
+    JobControl m_control;
+    QFutureWatcher<bool> m_watcher;
+    QTimer m_progressTimer;
+    QElapsedTimer m_elapsed;
+};
+
+#endif // BULKJOB_H
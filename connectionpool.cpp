@@ -0,0 +1,121 @@
+#include "connectionpool.h"
+#include "scoreaggregates.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QDebug>
+
+namespace {
+
+// 多条连接同时访问一个文件时，遇到锁先等待而不是立即报 "database is locked"
+const char *ConnectOptions = "QSQLITE_BUSY_TIMEOUT=5000";
+
+} // namespace
+
+ConnectionPool::ThreadContext::ThreadContext(ConnectionPool *pool, const QString &name)
+    : pool(pool)
+    , name(name)
+{
+    QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", name);
+    database.setDatabaseName(pool->databasePath());
+    database.setConnectOptions(ConnectOptions);
+    statements.setDatabase(database);
+}
+
+ConnectionPool::ThreadContext::~ThreadContext()
+{
+    // 先释放所有引用该连接的语句和句柄，removeDatabase才不会警告连接仍在使用
+    {
+        QSqlDatabase database = QSqlDatabase::database(name, false);
+        statements.setDatabase(QSqlDatabase());
+        if (database.isOpen()) {
+            database.close();
+            pool->m_openCount.deref();
+        }
+    }
+    QSqlDatabase::removeDatabase(name);
+}
+
+ConnectionPool::ConnectionPool(const QString &baseName)
+    : m_baseName(baseName)
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+}
+
+void ConnectionPool::setDatabasePath(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    m_databasePath = path;
+}
+
+QString ConnectionPool::databasePath() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_databasePath;
+}
+
+void ConnectionPool::setProfile(const StorageProfile &profile)
+{
+    QMutexLocker locker(&m_mutex);
+    m_profile = profile;
+}
+
+StorageProfile ConnectionPool::profile() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_profile;
+}
+
+ConnectionPool::ThreadContext *ConnectionPool::context()
+{
+    // QThreadStorage 本身就是按线程隔离的，这里不需要加锁
+    if (!m_contexts.hasLocalData()) {
+        QString name = m_baseName;
+        QCoreApplication *app = QCoreApplication::instance();
+        if (!app || QThread::currentThread() != app->thread()) {
+            name += QString("_%1").arg(m_nextId.fetchAndAddRelaxed(1) + 1);
+        }
+        m_contexts.setLocalData(new ThreadContext(this, name));
+    }
+    return m_contexts.localData();
+}
+
+QSqlDatabase ConnectionPool::connection()
+{
+    ThreadContext *ctx = context();
+    QSqlDatabase database = QSqlDatabase::database(ctx->name, false);
+    if (!database.isOpen()) {
+        if (database.open()) {
+            m_openCount.ref();
+            profile().apply(database);
+            ScoreAggregates::install(database);
+            qDebug() << "打开数据库连接:" << ctx->name;
+        } else {
+            qDebug() << "数据库连接打开失败:" << ctx->name << database.lastError().text();
+        }
+    }
+    return database;
+}
+
+StatementCache &ConnectionPool::statements()
+{
+    // 确保连接已打开，语句才能预编译
+    connection();
+    return context()->statements;
+}
+
+bool ConnectionPool::hasOpenConnection() const
+{
+    if (!m_contexts.hasLocalData())
+        return false;
+    return QSqlDatabase::database(m_contexts.localData()->name, false).isOpen();
+}
+
+int ConnectionPool::connectionCount() const
+{
+    return m_openCount.loadRelaxed();
+}
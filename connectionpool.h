@@ -0,0 +1,62 @@
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QSqlDatabase>
+#include <QThreadStorage>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QString>
+#include "statementcache.h"
+#include "storageconfig.h"
+
+// 按线程分配的连接池：Qt的数据库连接只能在创建它的线程中使用，
+// 因此每个线程第一次访问时为它打开一条指向同一数据库文件的连接，
+// 连接和它的预编译语句缓存一起保存在线程本地存储中，线程结束时自动关闭
+class ConnectionPool
+{
+public:
+    // 界面线程的连接沿用 baseName，其他线程为 baseName_N
+    explicit ConnectionPool(const QString &baseName);
+    ~ConnectionPool();
+
+    // 只影响之后新建的连接
+    void setDatabasePath(const QString &path);
+    QString databasePath() const;
+    void setProfile(const StorageProfile &profile);
+    StorageProfile profile() const;
+
+    // 当前线程的连接，首次调用时创建并打开
+    QSqlDatabase connection();
+    // 当前线程连接上的语句缓存
+    StatementCache &statements();
+    // 当前线程是否已有打开的连接（不会创建新连接）
+    bool hasOpenConnection() const;
+
+    // 目前已打开的连接数（所有线程）
+    int connectionCount() const;
+
+private:
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    struct ThreadContext {
+        ThreadContext(ConnectionPool *pool, const QString &name);
+        ~ThreadContext();
+
+        ConnectionPool *pool;
+        QString name;
+        StatementCache statements;
+    };
+
+    ThreadContext *context();
+
+    QString m_baseName;
+    mutable QMutex m_mutex;
+    QString m_databasePath;
+    StorageProfile m_profile;
+    QThreadStorage<ThreadContext *> m_contexts;
+    QAtomicInt m_nextId;
+    QAtomicInt m_openCount;
+};
+
+#endif // CONNECTIONPOOL_H
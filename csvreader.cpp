@@ -0,0 +1,297 @@
+#include "csvreader.h"
+#include <cstring>
+
+namespace {
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline int digitsToInt(const char *p, int count)
+{
+    int value = 0;
+    for (int i = 0; i < count; ++i)
+        value = value * 10 + (p[i] - '0');
+    return value;
+}
+
+} // namespace
+
+QString CsvField::toString() const
+{
+    QString text = QString::fromUtf8(data, size);
+    if (escaped)
+        text.replace(QLatin1String("\"\""), QLatin1String("\""));
+    return text;
+}
+
+double CsvField::toDouble(bool *ok) const
+{
+    // fromRawData不复制数据；QByteArray::toDouble与系统区域设置无关
+    return QByteArray::fromRawData(data, size).toDouble(ok);
+}
+
+QDate CsvField::toDate() const
+{
+    // 快速路径：yyyy-MM-dd 直接按位解析，避免格式字符串解析
+    if (size == 10 && data[4] == '-' && data[7] == '-'
+        && isDigit(data[0]) && isDigit(data[1]) && isDigit(data[2]) && isDigit(data[3])
+        && isDigit(data[5]) && isDigit(data[6]) && isDigit(data[8]) && isDigit(data[9])) {
+        return QDate(digitsToInt(data, 4), digitsToInt(data + 5, 2), digitsToInt(data + 8, 2));
+    }
+    return QDate::fromString(toString().trimmed(), Qt::ISODate);
+}
+
+CsvTokenizer::CsvTokenizer(const char *begin, const char *end, char delimiter)
+    : m_pos(begin)
+    , m_end(end)
+    , m_delimiter(delimiter)
+{
+}
+
+bool CsvTokenizer::readRow(QVector<CsvField> &fields)
+{
+    // resize(0) 保留已分配的容量，后续行不再重新分配
+    fields.resize(0);
+
+    // 跳过空行
+    while (m_pos < m_end && (*m_pos == '\n' || *m_pos == '\r'))
+        ++m_pos;
+    if (m_pos >= m_end)
+        return false;
+
+    const char *p = m_pos;
+    for (;;) {
+        CsvField field;
+
+        while (p < m_end && isBlank(*p))
+            ++p;
+
+        if (p < m_end && *p == '"') {
+            // 引号字段：一直扫描到未被转义的结束引号
+            const char *start = ++p;
+            for (;;) {
+                const char *quote = static_cast<const char *>(memchr(p, '"', m_end - p));
+                if (!quote) {
+                    // 引号未闭合，取到文件末尾
+                    p = m_end;
+                    break;
+                }
+                if (quote + 1 < m_end && quote[1] == '"') {
+                    field.escaped = true;
+                    p = quote + 2;
+                    continue;
+                }
+                p = quote;
+                break;
+            }
+            field.data = start;
+            field.size = int(p - start);
+            if (p < m_end)
+                ++p; // 跳过结束引号
+            // 结束引号与分隔符之间的多余字符忽略
+            while (p < m_end && *p != m_delimiter && *p != '\n' && *p != '\r')
+                ++p;
+        } else {
+            const char *start = p;
+            while (p < m_end && *p != m_delimiter && *p != '\n' && *p != '\r')
+                ++p;
+            const char *stop = p;
+            while (stop > start && isBlank(stop[-1]))
+                --stop;
+            field.data = start;
+            field.size = int(stop - start);
+        }
+
+        fields.append(field);
+
+        if (p < m_end && *p == m_delimiter) {
+            ++p;
+            continue;
+        }
+        if (p < m_end && *p == '\r')
+            ++p;
+        if (p < m_end && *p == '\n')
+            ++p;
+        break;
+    }
+
+    m_pos = p;
+    return true;
+}
+
+bool CsvTokenizer::atEnd() const
+{
+    return m_pos >= m_end;
+}
+
+const char *CsvTokenizer::position() const
+{
+    return m_pos;
+}
+
+CsvFile::CsvFile(const QString &filePath)
+    : m_file(filePath)
+    , m_map(nullptr)
+    , m_begin(nullptr)
+    , m_end(nullptr)
+{
+}
+
+CsvFile::~CsvFile()
+{
+    close();
+}
+
+bool CsvFile::open()
+{
+    // 内存映射要求以二进制方式打开，不能带 QIODevice::Text
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    qint64 fileSize = m_file.size();
+    if (fileSize > 0) {
+        m_map = m_file.map(0, fileSize);
+        if (m_map) {
+            m_begin = reinterpret_cast<const char *>(m_map);
+        } else {
+            m_buffer = m_file.readAll();
+            m_begin = m_buffer.constData();
+            fileSize = m_buffer.size();
+        }
+    } else {
+        m_begin = m_buffer.constData();
+        fileSize = 0;
+    }
+    m_end = m_begin + fileSize;
+
+    // 跳过UTF-8 BOM
+    if (m_end - m_begin >= 3
+        && uchar(m_begin[0]) == 0xEF && uchar(m_begin[1]) == 0xBB && uchar(m_begin[2]) == 0xBF) {
+        m_begin += 3;
+    }
+
+    return true;
+}
+
+void CsvFile::close()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_buffer.clear();
+    m_begin = m_end = nullptr;
+    m_file.close();
+}
+
+QString CsvFile::errorString() const
+{
+    return m_error;
+}
+
+const char *CsvFile::begin() const
+{
+    return m_begin;
+}
+
+const char *CsvFile::end() const
+{
+    return m_end;
+}
+
+qint64 CsvFile::size() const
+{
+    return m_end - m_begin;
+}
+
+CsvWriter::CsvWriter(QIODevice *device, int bufferSize)
+    : m_device(device)
+    , m_bufferSize(bufferSize > 0 ? bufferSize : (1 << 20))
+    , m_rowStart(true)
+    , m_error(false)
+{
+    // 多预留一些空间，避免单个长字段导致缓冲区重新分配
+    m_buffer.reserve(m_bufferSize + 4096);
+}
+
+CsvWriter::~CsvWriter()
+{
+    flush();
+}
+
+void CsvWriter::beginField()
+{
+    if (!m_rowStart)
+        m_buffer.append(',');
+    m_rowStart = false;
+}
+
+void CsvWriter::writeField(const QString &text)
+{
+    writeField(text.toUtf8());
+}
+
+void CsvWriter::writeField(const QByteArray &utf8)
+{
+    beginField();
+
+    bool needsQuotes = !utf8.isEmpty() && (isBlank(utf8.front()) || isBlank(utf8.back()));
+    for (int i = 0; i < utf8.size() && !needsQuotes; ++i) {
+        char c = utf8.at(i);
+        needsQuotes = c == ',' || c == '"' || c == '\n' || c == '\r';
+    }
+
+    if (!needsQuotes) {
+        m_buffer.append(utf8);
+        return;
+    }
+
+    m_buffer.append('"');
+    for (int i = 0; i < utf8.size(); ++i) {
+        char c = utf8.at(i);
+        if (c == '"')
+            m_buffer.append('"');
+        m_buffer.append(c);
+    }
+    m_buffer.append('"');
+}
+
+void CsvWriter::writeNumber(double value, int precision)
+{
+    beginField();
+    m_buffer.append(QByteArray::number(value, 'f', precision));
+}
+
+void CsvWriter::endRow()
+{
+    m_buffer.append('\n');
+    m_rowStart = true;
+    if (m_buffer.size() >= m_bufferSize)
+        flush();
+}
+
+bool CsvWriter::flush()
+{
+    if (m_buffer.isEmpty() || m_error)
+        return !m_error;
+
+    if (m_device->write(m_buffer) != m_buffer.size())
+        m_error = true;
+    // clear()会释放内存，resize(0)保留容量供下一批使用
+    m_buffer.resize(0);
+    return !m_error;
+}
+
+bool CsvWriter::hasError() const
+{
+    return m_error;
+}
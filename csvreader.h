@@ -0,0 +1,101 @@
+#ifndef CSVREADER_H
+#define CSVREADER_H
+
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QDate>
+
+// CSV字段视图：直接指向文件映射的内存，解析时不为字段分配任何内存
+struct CsvField {
+    const char *data = nullptr;
+    int size = 0;
+    bool escaped = false;   // 引号字段中含有转义的 ""，取值时需要还原为 "
+
+    bool isEmpty() const { return size == 0; }
+
+    // 以下取值函数才会真正产生QString等对象
+    QString toString() const;
+    double toDouble(bool *ok = nullptr) const;
+    QDate toDate() const;
+};
+
+// RFC 4180 分词器，作用于 [begin, end) 这段内存
+// 支持引号字段（字段内可含逗号、换行和 "" 转义）以及 LF / CRLF 行尾
+class CsvTokenizer
+{
+public:
+    CsvTokenizer(const char *begin, const char *end, char delimiter = ',');
+
+    // 读取下一行到 fields（复用其容量），到达末尾返回false，空行自动跳过
+    bool readRow(QVector<CsvField> &fields);
+
+    bool atEnd() const;
+    const char *position() const;
+
+private:
+    const char *m_pos;
+    const char *m_end;
+    char m_delimiter;
+};
+
+// 以内存映射方式打开CSV文件，并跳过UTF-8 BOM
+// 无法映射时（例如某些网络文件系统）退回到一次性读入内存
+class CsvFile
+{
+public:
+    explicit CsvFile(const QString &filePath);
+    ~CsvFile();
+
+    bool open();
+    void close();
+    QString errorString() const;
+
+    const char *begin() const;
+    const char *end() const;
+    qint64 size() const;
+
+private:
+    CsvFile(const CsvFile&) = delete;
+    CsvFile& operator=(const CsvFile&) = delete;
+
+    QFile m_file;
+    uchar *m_map;
+    QByteArray m_buffer;
+    const char *m_begin;
+    const char *m_end;
+    QString m_error;
+};
+
+// 带大缓冲区的CSV写入器：数据先攒在内存中，满了才一次性写入设备
+// 字段含分隔符、引号、换行或首尾空白时按 RFC 4180 加引号
+class CsvWriter
+{
+public:
+    explicit CsvWriter(QIODevice *device, int bufferSize = 1 << 20);
+    ~CsvWriter();
+
+    void writeField(const QString &text);
+    void writeField(const QByteArray &utf8);
+    void writeNumber(double value, int precision);
+    void endRow();
+
+    bool flush();
+    bool hasError() const;
+
+private:
+    CsvWriter(const CsvWriter&) = delete;
+    CsvWriter& operator=(const CsvWriter&) = delete;
+
+    void beginField();
+
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    int m_bufferSize;
+    bool m_rowStart;
+    bool m_error;
+};
+
+#endif // CSVREADER_H
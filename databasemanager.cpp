@@ -1,47 +1,65 @@
 #include "databasemanager.h"
+#include "scorebulkwriter.h"
+#include "importpipeline.h"
+#include "jobcontrol.h"
+#include "xlsxreader.h"
+#include "scoresnapshot.h"
+#include "dimensionresolver.h"
+#include "schemamigrator.h"
+#include "scoreaggregates.h"
 #include <QFile>
-#include <QTextStream>
 #include <QFileInfo>
-#include <QMessageBox>
 #include <QApplication>
 #include <QDir>
-
-DatabaseManager* DatabaseManager::m_instance = nullptr;
-
-DatabaseManager::DatabaseManager(QObject *parent) : QObject(parent)
+#include <QElapsedTimer>
+#include <QThread>
+
+DatabaseManager::DatabaseManager(QObject *parent)
+    : QObject(parent)
+    , m_pool("StudentScoresConnection")
+    , m_importBatchSize(ScoreBulkWriter::DefaultBatchSize)
+    , m_importMode(ImportMode::Upsert)
+    , m_hasSearchIndex(0)
 {
-    // 设置数据库文件路径
-    QString dbPath = "C:/Users/bill/Desktop/student_scores.db";
-
-    // 确保桌面目录存在
-    QDir desktopDir("C:/Users/bill/Desktop");
-    if (!desktopDir.exists()) {
-        qDebug() << "桌面目录不存在，尝试创建...";
-        if (!desktopDir.mkpath(".")) {
-            qDebug() << "无法创建桌面目录";
-            return;
+    // 数据库位置和存储参数来自配置文件或环境变量，见 storageconfig.h
+    StorageConfig config = StorageConfig::load();
+    QString dbPath = config.databasePath;
+
+    // 确保数据库所在目录存在
+    QDir dbDir = QFileInfo(dbPath).absoluteDir();
+    if (!dbDir.exists()) {
+        qDebug() << "数据库目录不存在，尝试创建...";
+        if (!dbDir.mkpath(".")) {
+            qDebug() << "无法创建数据库目录:" << dbDir.absolutePath();
         }
     }
 
     qDebug() << "数据库路径:" << dbPath;
+    qDebug() << "存储配置:" << config.profile.name << config.profile.pragmas()
+             << (config.configFile.isEmpty() ? QString("（未使用配置文件）") : config.configFile);
+
+    // 各线程的连接在第一次使用时由连接池打开
+    m_pool.setDatabasePath(dbPath);
+    m_pool.setProfile(config.profile);
 
-    // 连接数据库
-    m_database = QSqlDatabase::addDatabase("QSQLITE", "StudentScoresConnection");
-    m_database.setDatabaseName(dbPath);
+    // 查询线程常驻，连接和预编译语句缓存在两次查询之间保持可用；
+    // 一次统计会同时发出统计、分布、趋势、对比四个查询，线程数足够让它们并行执行
+    m_queryPool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 4));
+    m_queryPool.setExpiryTimeout(-1);
 }
 
 DatabaseManager* DatabaseManager::instance()
 {
-    if (!m_instance) {
-        m_instance = new DatabaseManager();
-    }
-    return m_instance;
+    // 局部静态变量的初始化由编译器保证线程安全，多个线程同时首次调用也只会创建一个实例
+    static DatabaseManager *instance = new DatabaseManager();
+    return instance;
 }
 
 bool DatabaseManager::initializeDatabase()
 {
-    if (!m_database.open()) {
-        qDebug() << "数据库错误:" << m_database.lastError().text();
+    QSqlDatabase database = connection();
+    if (!database.isOpen()) {
+        qDebug() << "数据库错误:" << database.lastError().text();
         return false;
     }
 
@@ -53,11 +71,19 @@ bool DatabaseManager::initializeDatabase()
         return false;
     }
 
-    // 检查数据库是否已有数据
-    QSqlQuery query(m_database);
-    query.prepare("SELECT COUNT(*) FROM scores");
-    if (query.exec() && query.next()) {
-        int count = query.value(0).toInt();
+    // 迁移时可能因 SQLite 不支持而没有建立搜索索引，SQLite 升级后在这里补建
+    SchemaMigrator migrator(database);
+    m_hasSearchIndex.storeRelease(migrator.ensureSearchIndex() ? 1 : 0);
+    qDebug() << "学号/姓名搜索索引:" << (m_hasSearchIndex.loadAcquire() ? "FTS5 trigram" : "无（使用 LIKE）");
+
+    // 日志由打开同一数据库文件的所有客户端共用，启动时只清理过期的部分
+    pruneChanges();
+
+    QSqlQuery query(database);
+
+    // 检查数据库是否已有数据：由汇总表得到总行数，不扫描成绩表
+    if (query.exec("SELECT COALESCE(SUM(count), 0) FROM score_summary") && query.next()) {
+        qint64 count = query.value(0).toLongLong();
         qDebug() << "数据库中有" << count << "条记录";
     }
 
@@ -66,97 +92,150 @@ bool DatabaseManager::initializeDatabase()
 
 bool DatabaseManager::createTables()
 {
-    QSqlQuery query(m_database);
-
-    // 创建学生成绩表
-    bool success = query.exec(
-        "CREATE TABLE IF NOT EXISTS scores ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "student_id TEXT NOT NULL,"
-        "student_name TEXT NOT NULL,"
-        "class_name TEXT NOT NULL,"
-        "course TEXT NOT NULL,"
-        "score REAL NOT NULL,"
-        "exam_date DATE NOT NULL,"
-        "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
-        ")"
-        );
-
-    if (!success) {
-        qDebug() << "创建表错误:" << query.lastError().text();
+    // 表结构由迁移列表维护：新数据库从版本0依次建到最新版本，旧数据库只执行缺少的迁移
+    SchemaMigrator migrator(connection());
+    if (!migrator.migrate()) {
+        qDebug() << "创建表错误:" << migrator.lastError();
         return false;
     }
-
-    // 创建索引以提高查询性能
-    query.exec("CREATE INDEX IF NOT EXISTS idx_student_id ON scores(student_id)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_class_course ON scores(class_name, course)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_exam_date ON scores(exam_date)");
-
+    qDebug() << "数据库结构版本:" << migrator.currentVersion();
+    m_startupNotices = migrator.notices();
     return true;
 }
 
 bool DatabaseManager::addScore(const StudentScore &score)
 {
-    QSqlQuery query(m_database);
-    query.prepare(
-        "INSERT INTO scores (student_id, student_name, class_name, course, score, exam_date) "
-        "VALUES (:student_id, :student_name, :class_name, :course, :score, :exam_date)"
-        );
-    query.bindValue(":student_id", score.studentId);
-    query.bindValue(":student_name", score.studentName);
-    query.bindValue(":class_name", score.className);
-    query.bindValue(":course", score.course);
-    query.bindValue(":score", score.score);
-    query.bindValue(":exam_date", score.examDate.toString("yyyy-MM-dd"));
-
-    bool success = query.exec();
-    if (!success) {
-        qDebug() << "添加成绩错误:" << query.lastError().text();
-    } else {
+    DimensionResolver dimensions(m_pool.statements());
+    bool success = writeScore(dimensions, score, -1);
+    if (success) {
         qDebug() << "成功添加成绩:" << score.studentName << score.course << score.score;
     }
-
     return success;
 }
 
 bool DatabaseManager::updateScore(int id, const StudentScore &score)
 {
-    QSqlQuery query(m_database);
-    query.prepare(
-        "UPDATE scores SET "
-        "student_id = :student_id, "
-        "student_name = :student_name, "
-        "class_name = :class_name, "
-        "course = :course, "
-        "score = :score, "
-        "exam_date = :exam_date "
-        "WHERE id = :id"
+    DimensionResolver dimensions(m_pool.statements());
+    return writeScore(dimensions, score, id);
+}
+
+bool DatabaseManager::deleteScore(int id)
+{
+    return removeScore(id);
+}
+
+bool DatabaseManager::addScores(const QList<StudentScore> &scores)
+{
+    // 解析器的维度键缓存在整批内共用，同一班级、课程只查一次
+    DimensionResolver dimensions(m_pool.statements());
+    return runInTransaction("批量添加成绩", scores.size(), [&]() {
+        for (const StudentScore &score : scores) {
+            if (!writeScore(dimensions, score, -1))
+                return false;
+        }
+        return true;
+    });
+}
+
+bool DatabaseManager::updateScores(const QList<StudentScore> &scores)
+{
+    DimensionResolver dimensions(m_pool.statements());
+    return runInTransaction("批量更新成绩", scores.size(), [&]() {
+        for (const StudentScore &score : scores) {
+            if (!writeScore(dimensions, score, score.id))
+                return false;
+        }
+        return true;
+    });
+}
+
+bool DatabaseManager::deleteScores(const QList<int> &ids)
+{
+    return runInTransaction("批量删除成绩", ids.size(), [&]() {
+        for (int id : ids) {
+            if (!removeScore(id))
+                return false;
+        }
+        return true;
+    });
+}
+
+bool DatabaseManager::runInTransaction(const char *operation, int rowCount, const std::function<bool()> &work)
+{
+    QSqlDatabase database = connection();
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!database.transaction()) {
+        qDebug() << operation << "开始事务失败:" << database.lastError().text();
+        return false;
+    }
+    if (!work()) {
+        database.rollback();
+        qDebug() << operation << "失败，已回滚";
+        return false;
+    }
+    if (!database.commit()) {
+        qDebug() << operation << "提交失败:" << database.lastError().text();
+        database.rollback();
+        return false;
+    }
+
+    qDebug() << operation << rowCount << "条，耗时" << timer.elapsed() << "ms";
+    return true;
+}
+
+bool DatabaseManager::writeScore(DimensionResolver &dimensions, const StudentScore &score, int id)
+{
+    const char *operation = id < 0 ? "添加成绩错误:" : "更新成绩错误:";
+    DimensionResolver::Keys keys;
+    if (!dimensions.resolve(score, keys)) {
+        qDebug() << operation << dimensions.lastError();
+        return false;
+    }
+
+    CachedQuery query(m_pool.statements(), id < 0
+        ? "INSERT INTO score_facts (student_key, class_key, course_key, score, exam_date) "
+          "VALUES (:student_key, :class_key, :course_key, :score, :exam_date)"
+        : "UPDATE score_facts SET "
+          "student_key = :student_key, "
+          "class_key = :class_key, "
+          "course_key = :course_key, "
+          "score = :score, "
+          "exam_date = :exam_date "
+          "WHERE id = :id"
         );
-    query.bindValue(":student_id", score.studentId);
-    query.bindValue(":student_name", score.studentName);
-    query.bindValue(":class_name", score.className);
-    query.bindValue(":course", score.course);
-    query.bindValue(":score", score.score);
-    query.bindValue(":exam_date", score.examDate.toString("yyyy-MM-dd"));
-    query.bindValue(":id", id);
-
-    bool success = query.exec();
+    if (!query.isValid()) {
+        return false;
+    }
+    query->bindValue(":student_key", keys.student);
+    query->bindValue(":class_key", keys.className);
+    query->bindValue(":course_key", keys.course);
+    query->bindValue(":score", score.score);
+    query->bindValue(":exam_date", score.examDate.toJulianDay());
+    if (id >= 0) {
+        query->bindValue(":id", id);
+    }
+
+    bool success = query->exec();
     if (!success) {
-        qDebug() << "更新成绩错误:" << query.lastError().text();
+        qDebug() << operation << query->lastError().text();
     }
 
     return success;
 }
 
-bool DatabaseManager::deleteScore(int id)
+bool DatabaseManager::removeScore(int id)
 {
-    QSqlQuery query(m_database);
-    query.prepare("DELETE FROM scores WHERE id = :id");
-    query.bindValue(":id", id);
+    CachedQuery query(m_pool.statements(), "DELETE FROM score_facts WHERE id = :id");
+    if (!query.isValid()) {
+        return false;
+    }
+    query->bindValue(":id", id);
 
-    bool success = query.exec();
+    bool success = query->exec();
     if (!success) {
-        qDebug() << "删除成绩错误:" << query.lastError().text();
+        qDebug() << "删除成绩错误:" << query->lastError().text();
     }
 
     return success;
@@ -165,155 +244,410 @@ bool DatabaseManager::deleteScore(int id)
 QList<StudentScore> DatabaseManager::getAllScores()
 {
     QList<StudentScore> scores;
-    QSqlQuery query(m_database);
-    query.prepare("SELECT id, student_id, student_name, class_name, course, score, exam_date FROM scores ORDER BY exam_date DESC");
+    // 与分页查询相同的 (考试日期, ID) 降序，表格模型按这个顺序插入增量变更
+    CachedQuery query(m_pool.statements(), "SELECT id, student_id, student_name, class_name, course, score, exam_date FROM scores ORDER BY exam_date DESC, id DESC");
 
-    if (!query.exec()) {
-        qDebug() << "获取所有成绩错误:" << query.lastError().text();
+    if (!query.isValid()) {
         return scores;
     }
 
-    while (query.next()) {
-        StudentScore score;
-        score.id = query.value(0).toInt();
-        score.studentId = query.value(1).toString();
-        score.studentName = query.value(2).toString();
-        score.className = query.value(3).toString();
-        score.course = query.value(4).toString();
-        score.score = query.value(5).toDouble();
-        score.examDate = QDate::fromString(query.value(6).toString(), "yyyy-MM-dd");
-        scores.append(score);
+    if (!query->exec()) {
+        qDebug() << "获取所有成绩错误:" << query->lastError().text();
+        return scores;
+    }
+
+    while (query->next()) {
+        scores.append(readScore(*query));
     }
 
     qDebug() << "获取到" << scores.size() << "条成绩记录";
     return scores;
 }
 
-QList<StudentScore> DatabaseManager::getScoresByFilter(const QString &className, const QString &course, const QString &keyword)
+bool DatabaseManager::useSearchIndex(const QString &keyword) const
 {
-    QList<StudentScore> scores;
-    QString sql = "SELECT id, student_id, student_name, class_name, course, score, exam_date FROM scores WHERE 1=1";
+    // trigram 索引只能匹配至少3个字符的子串，更短的关键字只能逐个比较
+    return m_hasSearchIndex.loadAcquire() && keyword.length() >= 3;
+}
 
+QString DatabaseManager::filterClause(const QString &className, const QString &course, const QString &keyword) const
+{
+    QString clause;
+    // 班级和课程先在维度表中换成整数键（只查一次），再按事实表上的整数索引过滤
     if (!className.isEmpty() && className != "所有班级") {
-        sql += " AND class_name = :class_name";
+        clause += " AND class_key = (SELECT id FROM classes WHERE name = :class_name)";
     }
     if (!course.isEmpty() && course != "所有课程") {
-        sql += " AND course = :course";
+        clause += " AND course_key = (SELECT id FROM courses WHERE name = :course)";
     }
-    if (!keyword.isEmpty()) {
-        sql += " AND (student_id LIKE :keyword OR student_name LIKE :keyword)";
+    // 关键字先在学生维度表（远小于成绩表）上找出匹配的学生，再按学生键取成绩
+    if (useSearchIndex(keyword)) {
+        clause += " AND student_key IN (SELECT rowid FROM student_search WHERE student_search MATCH :keyword)";
+    } else if (!keyword.isEmpty()) {
+        clause += " AND student_key IN (SELECT id FROM students WHERE student_no LIKE :keyword OR name LIKE :keyword)";
     }
-    sql += " ORDER BY exam_date DESC";
-
-    QSqlQuery query(m_database);
-    query.prepare(sql);
+    return clause;
+}
 
+void DatabaseManager::bindFilter(QSqlQuery &query, const QString &className, const QString &course, const QString &keyword) const
+{
     if (!className.isEmpty() && className != "所有班级") {
         query.bindValue(":class_name", className);
     }
     if (!course.isEmpty() && course != "所有课程") {
         query.bindValue(":course", course);
     }
-    if (!keyword.isEmpty()) {
+    if (useSearchIndex(keyword)) {
+        // 作为一个短语匹配（任意列中出现该子串），关键字中的双引号按FTS5语法写两次
+        query.bindValue(":keyword", "\"" + QString(keyword).replace("\"", "\"\"") + "\"");
+    } else if (!keyword.isEmpty()) {
         query.bindValue(":keyword", "%" + keyword + "%");
     }
+}
 
-    if (!query.exec()) {
-        qDebug() << "查询错误:" << query.lastError().text();
+QList<StudentScore> DatabaseManager::getScoresByFilter(const QString &className, const QString &course, const QString &keyword,
+                                                       const CancelCheck &cancelled)
+{
+    QList<StudentScore> scores;
+    QString sql = "SELECT id, student_id, student_name, class_name, course, score, exam_date FROM scores WHERE 1=1";
+    sql += filterClause(className, course, keyword);
+    sql += " ORDER BY exam_date DESC";
+
+    // 同一种筛选组合得到相同的SQL，逐键搜索时只重新绑定参数
+    CachedQuery query(m_pool.statements(), sql);
+    if (!query.isValid()) {
         return scores;
     }
+    bindFilter(*query, className, course, keyword);
 
-    while (query.next()) {
-        StudentScore score;
-        score.id = query.value(0).toInt();
-        score.studentId = query.value(1).toString();
-        score.studentName = query.value(2).toString();
-        score.className = query.value(3).toString();
-        score.course = query.value(4).toString();
-        score.score = query.value(5).toDouble();
-        score.examDate = QDate::fromString(query.value(6).toString(), "yyyy-MM-dd");
-        scores.append(score);
+    if (!query->exec()) {
+        qDebug() << "查询错误:" << query->lastError().text();
+        return scores;
+    }
+
+    while (query->next()) {
+        scores.append(readScore(*query));
+        if (scores.size() % CancelCheckRows == 0 && cancelled && cancelled()) {
+            qDebug() << "筛选查询已取消，已读取" << scores.size() << "条";
+            return QList<StudentScore>();
+        }
     }
 
     return scores;
 }
 
-QMap<QString, QVariant> DatabaseManager::calculateStatistics(const QString &className, const QString &course)
+QList<StudentScore> DatabaseManager::getScoresPage(const QString &className, const QString &course,
+                                                   const QString &keyword, const ScoreCursor &after, int limit)
 {
-    QMap<QString, QVariant> stats;
-    QString sql = "SELECT "
-                  "COUNT(*) as count, "
-                  "AVG(score) as avg_score, "
-                  "MAX(score) as max_score, "
-                  "MIN(score) as min_score, "
-                  "SUM(CASE WHEN score >= 60 THEN 1 ELSE 0 END) as pass_count "
-                  "FROM scores WHERE 1=1";
+    QList<StudentScore> scores;
+    if (limit <= 0) {
+        return scores;
+    }
 
-    if (!className.isEmpty() && className != "所有班级") {
-        sql += " AND class_name = :class_name";
+    // 行值比较 (exam_date, id) < (游标) 可以直接作为索引范围条件；
+    // 各筛选组合都有以 exam_date 结尾的索引（rowid 隐含在索引末尾），按索引逆序读出即为结果顺序
+    QString sql = "SELECT id, student_id, student_name, class_name, course, score, exam_date FROM scores WHERE 1=1";
+    sql += filterClause(className, course, keyword);
+    if (after.isValid()) {
+        sql += " AND (exam_date, id) < (:cursor_date, :cursor_id)";
     }
-    if (!course.isEmpty() && course != "所有课程") {
-        sql += " AND course = :course";
+    sql += " ORDER BY exam_date DESC, id DESC LIMIT :limit";
+
+    CachedQuery query(m_pool.statements(), sql);
+    if (!query.isValid()) {
+        return scores;
+    }
+    bindFilter(*query, className, course, keyword);
+    if (after.isValid()) {
+        query->bindValue(":cursor_date", after.examDate.toJulianDay());
+        query->bindValue(":cursor_id", after.id);
     }
+    query->bindValue(":limit", limit);
 
-    QSqlQuery query(m_database);
-    query.prepare(sql);
+    if (!query->exec()) {
+        qDebug() << "分页查询错误:" << query->lastError().text();
+        return scores;
+    }
 
-    if (!className.isEmpty() && className != "所有班级") {
-        query.bindValue(":class_name", className);
+    scores.reserve(limit);
+    while (query->next()) {
+        scores.append(readScore(*query));
     }
-    if (!course.isEmpty() && course != "所有课程") {
-        query.bindValue(":course", course);
+    return scores;
+}
+
+QList<StudentScore> DatabaseManager::getAllScoresPage(const ScoreCursor &after, int limit)
+{
+    return getScoresPage("", "", "", after, limit);
+}
+
+qint64 DatabaseManager::countScores(const QString &className, const QString &course, const QString &keyword)
+{
+    // 班级/课程条件只涉及 class_key、course_key，汇总表上同样适用；关键字需要逐行按学生过滤
+    QString sql = keyword.isEmpty() ? "SELECT COALESCE(SUM(count), 0) FROM score_summary WHERE 1=1"
+                                    : "SELECT COUNT(*) FROM score_facts WHERE 1=1";
+    sql += filterClause(className, course, keyword);
+
+    CachedQuery query(m_pool.statements(), sql);
+    if (!query.isValid()) {
+        return 0;
+    }
+    bindFilter(*query, className, course, keyword);
+
+    if (!query->exec() || !query->next()) {
+        qDebug() << "计数查询错误:" << query->lastError().text();
+        return 0;
+    }
+    return query->value(0).toLongLong();
+}
+
+qint64 DatabaseManager::latestChangeVersion()
+{
+    // 日志可能已被清理为空，已分配的最大版本号以 sqlite_sequence 为准
+    CachedQuery query(m_pool.statements(), "SELECT seq FROM sqlite_sequence WHERE name = 'score_changes'");
+    if (!query.isValid()) {
+        return 0;
+    }
+    if (!query->exec()) {
+        qDebug() << "读取变更版本错误:" << query->lastError().text();
+        return 0;
+    }
+    return query->next() ? query->value(0).toLongLong() : 0;
+}
+
+bool DatabaseManager::getChangesSince(qint64 since, qint64 until, int limit, QList<ScoreChange> &changes)
+{
+    changes.clear();
+    if (since >= until) {
+        return true;
+    }
+
+    // since 之后的日志已有一部分被清理（过期，或由其他客户端清理）时无法补齐，由调用方整体重新读取
+    CachedQuery oldest(m_pool.statements(), "SELECT MIN(version) FROM score_changes");
+    if (!oldest.isValid()) {
+        return false;
+    }
+    if (!oldest->exec() || !oldest->next()) {
+        qDebug() << "读取变更日志错误:" << oldest->lastError().text();
+        return false;
+    }
+    if (oldest->value(0).isNull() || oldest->value(0).toLongLong() > since + 1) {
+        qDebug() << "版本" << since << "之后的变更日志已被清理，需要重新读取";
+        return false;
+    }
+
+    // 按成绩行分组，MAX(version) 同时决定同组中 operation 取自哪一条日志；
+    // 直接连接维度表（不经过 scores 视图），每个变更行只按主键查找一次
+    CachedQuery query(m_pool.statements(),
+        "SELECT f.id, s.student_no, s.name, cl.name, co.name, f.score, f.exam_date, "
+        "c.score_id, MAX(c.version), c.operation "
+        "FROM score_changes c "
+        "LEFT JOIN score_facts f ON f.id = c.score_id "
+        "LEFT JOIN students s ON s.id = f.student_key "
+        "LEFT JOIN classes cl ON cl.id = f.class_key "
+        "LEFT JOIN courses co ON co.id = f.course_key "
+        "WHERE c.version > :since AND c.version <= :until "
+        "GROUP BY c.score_id ORDER BY MAX(c.version) LIMIT :limit"
+        );
+    if (!query.isValid()) {
+        return false;
+    }
+    query->bindValue(":since", since);
+    query->bindValue(":until", until);
+    // 多取一行用来判断是否超过 limit
+    query->bindValue(":limit", limit + 1);
+
+    if (!query->exec()) {
+        qDebug() << "读取变更日志错误:" << query->lastError().text();
+        return false;
+    }
+
+    while (query->next()) {
+        if (changes.size() == limit) {
+            changes.clear();
+            return false;
+        }
+        ScoreChange change;
+        change.version = query->value(8).toLongLong();
+        if (query->value(0).isNull()) {
+            // 行已被删除（也可能是插入后又删除）
+            change.operation = ScoreChange::Delete;
+            change.score.id = query->value(7).toInt();
+            change.score.score = 0.0;
+        } else {
+            change.operation = static_cast<ScoreChange::Operation>(query->value(9).toInt());
+            change.score = readScore(*query);
+        }
+        changes.append(change);
+    }
+    return true;
+}
+
+void DatabaseManager::pruneChanges()
+{
+    CachedQuery query(m_pool.statements(),
+        "DELETE FROM score_changes WHERE changed_at < CAST(strftime('%s', 'now') AS INTEGER) - :retention");
+    if (!query.isValid()) {
+        return;
+    }
+    query->bindValue(":retention", ChangeRetentionSeconds);
+    if (!query->exec()) {
+        qDebug() << "清理变更日志错误:" << query->lastError().text();
+    }
+}
+
+StudentScore DatabaseManager::readScore(const QSqlQuery &query)
+{
+    StudentScore score;
+    score.id = query.value(0).toInt();
+    score.studentId = query.value(1).toString();
+    score.studentName = query.value(2).toString();
+    score.className = query.value(3).toString();
+    score.course = query.value(4).toString();
+    score.score = query.value(5).toDouble();
+    score.examDate = QDate::fromJulianDay(query.value(6).toLongLong());
+    return score;
+}
+
+QMap<QString, QVariant> DatabaseManager::calculateStatistics(const QString &className, const QString &course,
+                                                             const CancelCheck &cancelled)
+{
+    QMap<QString, QVariant> stats;
+    bool byClass = !className.isEmpty() && className != "所有班级";
+    bool byCourse = !course.isEmpty() && course != "所有课程";
+
+    QString where = " WHERE 1=1";
+    if (byClass) {
+        where += " AND class_key = (SELECT id FROM classes WHERE name = :class_name)";
+    }
+    if (byCourse) {
+        where += " AND course_key = (SELECT id FROM courses WHERE name = :course)";
     }
 
-    if (query.exec() && query.next()) {
-        int count = query.value("count").toInt();
-        double avg = query.value("avg_score").toDouble();
-        double max = query.value("max_score").toDouble();
-        double min = query.value("min_score").toDouble();
-        int passCount = query.value("pass_count").toInt();
+    // 人数、均值、极值、标准差和及格率来自触发器维护的 (班级, 课程) 汇总行，不扫描成绩
+    qint64 count = 0;
+    {
+        CachedQuery query(m_pool.statements(),
+                          "SELECT SUM(count), SUM(total), SUM(total_squares), MAX(max_score), MIN(min_score), "
+                          "SUM(pass_count) FROM score_summary" + where);
+        if (!query.isValid()) {
+            return stats;
+        }
+        if (byClass) {
+            query->bindValue(":class_name", className);
+        }
+        if (byCourse) {
+            query->bindValue(":course", course);
+        }
+        if (!query->exec() || !query->next()) {
+            qDebug() << "统计查询错误:" << query->lastError().text();
+            return stats;
+        }
+
+        count = query->value(0).toLongLong();
+        double avg = count > 0 ? query->value(1).toDouble() / count : 0.0;
+        // 总体方差 = 平方和的均值 - 均值的平方，舍入误差可能使结果略小于0
+        double variance = count > 0 ? query->value(2).toDouble() / count - avg * avg : 0.0;
+        int passCount = query->value(5).toInt();
 
-        stats["count"] = count;
+        stats["count"] = int(count);
         stats["avg"] = avg;
-        stats["max"] = max;
-        stats["min"] = min;
+        stats["max"] = query->value(3).toDouble();
+        stats["min"] = query->value(4).toDouble();
         stats["pass_rate"] = count > 0 ? (double(passCount) / count) * 100 : 0;
+        stats["std_dev"] = sqrt(qMax(0.0, variance));
+        if (count == 0) {
+            return stats;
+        }
+    }
 
-        // 计算标准差
-        if (count > 0) {
-            QString varianceSql = "SELECT SUM((score - :avg) * (score - :avg)) / COUNT(*) as variance FROM scores WHERE 1=1";
-            if (!className.isEmpty() && className != "所有班级") {
-                varianceSql += " AND class_name = :class_name";
-            }
-            if (!course.isEmpty() && course != "所有课程") {
-                varianceSql += " AND course = :course";
-            }
+    // 四分位数无法由汇总行得到，仍需一次扫描。连接上注册了原生聚合函数时（见 scoreaggregates.h）一次聚合得到；
+    // 否则按成绩升序读取（同时按班级、课程筛选时 (class_key, course_key, score) 覆盖索引直接给出顺序），
+    // 人数已由汇总行得到，读到第三四分位数所在的位置即可停止，成绩不在内存中保存
+    if (ScoreAggregates::isInstalled(connection())) {
+        CachedQuery query(m_pool.statements(),
+                          "SELECT percentile(score, 25), median(score), percentile(score, 75) FROM score_facts" + where);
+        if (!query.isValid()) {
+            return stats;
+        }
+        if (byClass) {
+            query->bindValue(":class_name", className);
+        }
+        if (byCourse) {
+            query->bindValue(":course", course);
+        }
+        if (query->exec() && query->next()) {
+            stats["q1"] = query->value(0).toDouble();
+            stats["median"] = query->value(1).toDouble();
+            stats["q3"] = query->value(2).toDouble();
+        } else {
+            qDebug() << "四分位数查询错误:" << query->lastError().text();
+        }
+        return stats;
+    }
 
-            QSqlQuery varianceQuery(m_database);
-            varianceQuery.prepare(varianceSql);
-            varianceQuery.bindValue(":avg", avg);
-            if (!className.isEmpty() && className != "所有班级") {
-                varianceQuery.bindValue(":class_name", className);
-            }
-            if (!course.isEmpty() && course != "所有课程") {
-                varianceQuery.bindValue(":course", course);
-            }
+    CachedQuery query(m_pool.statements(), "SELECT score FROM score_facts" + where + " ORDER BY score");
+    if (!query.isValid()) {
+        return stats;
+    }
+    if (byClass) {
+        query->bindValue(":class_name", className);
+    }
+    if (byCourse) {
+        query->bindValue(":course", course);
+    }
+    if (!query->exec()) {
+        qDebug() << "四分位数查询错误:" << query->lastError().text();
+        return stats;
+    }
 
-            if (varianceQuery.exec() && varianceQuery.next()) {
-                double variance = varianceQuery.value("variance").toDouble();
-                stats["std_dev"] = sqrt(variance);
-            } else {
-                stats["std_dev"] = 0.0;
-            }
-        } else {
-            stats["std_dev"] = 0.0;
+    // 第 p 百分位位于升序第 p/100*(count-1) 个，落在两个值之间时线性插值
+    const char *const keys[] = {"q1", "median", "q3"};
+    const double percents[] = {25.0, 50.0, 75.0};
+    qint64 lower[3];
+    double fraction[3];
+    double lowerValue[3] = {0.0, 0.0, 0.0};
+    double upperValue[3] = {0.0, 0.0, 0.0};
+    for (int i = 0; i < 3; ++i) {
+        double position = percents[i] / 100.0 * (count - 1);
+        lower[i] = qint64(position);
+        fraction[i] = position - lower[i];
+    }
+    qint64 lastRow = qMin<qint64>(lower[2] + 1, count - 1);
+
+    qint64 row = 0;
+    while (row <= lastRow && query->next()) {
+        double score = query->value(0).toDouble();
+        for (int i = 0; i < 3; ++i) {
+            if (row == lower[i])
+                lowerValue[i] = score;
+            if (row == lower[i] + 1)
+                upperValue[i] = score;
         }
+        ++row;
+        if (row % CancelCheckRows == 0 && cancelled && cancelled()) {
+            qDebug() << "四分位数统计已取消";
+            return stats;
+        }
+    }
+
+    // 汇总行与扫描之间成绩被删除时行数不够，此次不提供四分位数
+    if (row <= lastRow) {
+        qDebug() << "统计期间成绩发生变化，未计算四分位数";
+        return stats;
+    }
+    for (int i = 0; i < 3; ++i) {
+        double value = lowerValue[i];
+        if (fraction[i] > 0.0 && lower[i] + 1 < count)
+            value += fraction[i] * (upperValue[i] - value);
+        stats[keys[i]] = value;
     }
 
     return stats;
 }
 
-QList<QMap<QString, QVariant>> DatabaseManager::getScoreDistribution(const QString &className, const QString &course, int bins)
+QList<QMap<QString, QVariant>> DatabaseManager::getScoreDistribution(const QString &className, const QString &course, int bins,
+                                                                     const CancelCheck &cancelled)
 {
     QList<QMap<QString, QVariant>> distribution;
 
@@ -342,33 +676,39 @@ QList<QMap<QString, QVariant>> DatabaseManager::getScoreDistribution(const QStri
     }
 
     // 构建SQL查询
-    QString sql = "SELECT score FROM scores WHERE 1=1";
+    QString sql = "SELECT score FROM score_facts WHERE 1=1";
 
     if (!className.isEmpty() && className != "所有班级") {
-        sql += " AND class_name = :class_name";
+        sql += " AND class_key = (SELECT id FROM classes WHERE name = :class_name)";
     }
     if (!course.isEmpty() && course != "所有课程") {
-        sql += " AND course = :course";
+        sql += " AND course_key = (SELECT id FROM courses WHERE name = :course)";
     }
 
-    QSqlQuery query(m_database);
-    query.prepare(sql);
+    CachedQuery query(m_pool.statements(), sql);
+    if (!query.isValid()) {
+        return distribution;
+    }
 
     if (!className.isEmpty() && className != "所有班级") {
-        query.bindValue(":class_name", className);
+        query->bindValue(":class_name", className);
     }
     if (!course.isEmpty() && course != "所有课程") {
-        query.bindValue(":course", course);
+        query->bindValue(":course", course);
     }
 
     // 初始化统计数组
     QVector<int> counts(scoreRanges.size(), 0);
     int total = 0;
 
-    if (query.exec()) {
-        while (query.next()) {
-            double score = query.value(0).toDouble();
+    if (query->exec()) {
+        while (query->next()) {
+            double score = query->value(0).toDouble();
             total++;
+            if (total % CancelCheckRows == 0 && cancelled && cancelled()) {
+                qDebug() << "成绩分布统计已取消，已读取" << total << "条";
+                return QList<QMap<QString, QVariant>>();
+            }
 
             // 查找分数所在的区间
             for (int i = 0; i < scoreRanges.size(); i++) {
@@ -390,7 +730,7 @@ QList<QMap<QString, QVariant>> DatabaseManager::getScoreDistribution(const QStri
             distribution.append(binData);
         }
     } else {
-        qDebug() << "获取成绩分布错误:" << query.lastError().text();
+        qDebug() << "获取成绩分布错误:" << query->lastError().text();
     }
 
     qDebug() << "成绩分布统计完成，共" << total << "条记录，" << bins << "个区间";
@@ -401,32 +741,34 @@ QList<QMap<QString, QVariant>> DatabaseManager::getTrendData(const QString &stud
 {
     QList<QMap<QString, QVariant>> trendData;
 
-    QString sql = "SELECT exam_date, score FROM scores WHERE 1=1";
+    QString sql = "SELECT exam_date, score FROM score_facts WHERE 1=1";
 
     if (!studentId.isEmpty()) {
-        sql += " AND student_id = :student_id";
+        sql += " AND student_key = (SELECT id FROM students WHERE student_no = :student_id)";
     }
     if (!course.isEmpty() && course != "所有课程") {
-        sql += " AND course = :course";
+        sql += " AND course_key = (SELECT id FROM courses WHERE name = :course)";
     }
 
     sql += " ORDER BY exam_date ASC";
 
-    QSqlQuery query(m_database);
-    query.prepare(sql);
+    CachedQuery query(m_pool.statements(), sql);
+    if (!query.isValid()) {
+        return trendData;
+    }
 
     if (!studentId.isEmpty()) {
-        query.bindValue(":student_id", studentId);
+        query->bindValue(":student_id", studentId);
     }
     if (!course.isEmpty() && course != "所有课程") {
-        query.bindValue(":course", course);
+        query->bindValue(":course", course);
     }
 
-    if (query.exec()) {
-        while (query.next()) {
+    if (query->exec()) {
+        while (query->next()) {
             QMap<QString, QVariant> dataPoint;
-            QDate examDate = QDate::fromString(query.value(0).toString(), "yyyy-MM-dd");
-            double score = query.value(1).toDouble();
+            QDate examDate = QDate::fromJulianDay(query->value(0).toLongLong());
+            double score = query->value(1).toDouble();
 
             dataPoint["date"] = examDate.toString("yyyy-MM-dd");
             dataPoint["score"] = score;
@@ -435,87 +777,66 @@ QList<QMap<QString, QVariant>> DatabaseManager::getTrendData(const QString &stud
             trendData.append(dataPoint);
         }
     } else {
-        qDebug() << "获取趋势数据错误:" << query.lastError().text();
+        qDebug() << "获取趋势数据错误:" << query->lastError().text();
     }
 
     return trendData;
 }
 
-// 获取课程趋势数据（按考试日期分组，使用 DISTINCT 确保日期唯一）
+// 获取课程趋势数据：每个考试日期的人数、平均分、最高/最低分和标准差，
+// 由按 (班级, 课程, 考试日期) 的汇总行合并得到，不扫描成绩
 QList<QMap<QString, QVariant>> DatabaseManager::getCourseTrendData(const QString &className, const QString &course)
 {
     QList<QMap<QString, QVariant>> trendData;
 
-    QString sql = "SELECT DISTINCT exam_date, "
-                  "(SELECT AVG(score) FROM scores s2 WHERE s2.exam_date = s1.exam_date ";
+    QString sql = "SELECT exam_date, SUM(count), SUM(total), MIN(min_score), MAX(max_score), SUM(total_squares) "
+                  "FROM score_daily_summary WHERE 1=1";
 
     if (!className.isEmpty() && className != "所有班级") {
-        sql += " AND s2.class_name = :class_name";
+        sql += " AND class_key = (SELECT id FROM classes WHERE name = :class_name)";
     }
     if (!course.isEmpty() && course != "所有课程") {
-        sql += " AND s2.course = :course";
-    }
-    sql += ") as avg_score, ";
-
-    sql += "(SELECT COUNT(*) FROM scores s3 WHERE s3.exam_date = s1.exam_date ";
-    if (!className.isEmpty() && className != "所有班级") {
-        sql += " AND s3.class_name = :class_name2";
-    }
-    if (!course.isEmpty() && course != "所有课程") {
-        sql += " AND s3.course = :course2";
-    }
-    sql += ") as count ";
-
-    sql += "FROM scores s1 WHERE 1=1";
-
-    if (!className.isEmpty() && className != "所有班级") {
-        sql += " AND s1.class_name = :class_name3";
-    }
-    if (!course.isEmpty() && course != "所有课程") {
-        sql += " AND s1.course = :course3";
+        sql += " AND course_key = (SELECT id FROM courses WHERE name = :course)";
     }
 
     sql += " GROUP BY exam_date ORDER BY exam_date ASC";
 
-    QSqlQuery query(m_database);
-    query.prepare(sql);
+    CachedQuery query(m_pool.statements(), sql);
+    if (!query.isValid()) {
+        return trendData;
+    }
 
     if (!className.isEmpty() && className != "所有班级") {
-        query.bindValue(":class_name", className);
-        query.bindValue(":class_name2", className);
-        query.bindValue(":class_name3", className);
+        query->bindValue(":class_name", className);
     }
     if (!course.isEmpty() && course != "所有课程") {
-        query.bindValue(":course", course);
-        query.bindValue(":course2", course);
-        query.bindValue(":course3", course);
+        query->bindValue(":course", course);
     }
 
-    if (query.exec()) {
-        QSet<QString> uniqueDates; // 用于检查日期唯一性
-        while (query.next()) {
-            QDate examDate = QDate::fromString(query.value(0).toString(), "yyyy-MM-dd");
-            double avgScore = query.value(1).toDouble();
-            int count = query.value(2).toInt();
-
-            QString dateStr = examDate.toString("yyyy-MM-dd");
+    if (query->exec()) {
+        while (query->next()) {
+            QDate examDate = QDate::fromJulianDay(query->value(0).toLongLong());
+            int count = query->value(1).toInt();
+            double avgScore = count > 0 ? query->value(2).toDouble() / count : 0.0;
+            double sumSquares = query->value(5).toDouble();
 
-            // 检查日期是否已存在
-            if (!uniqueDates.contains(dateStr) && avgScore > 0) {
-                uniqueDates.insert(dateStr);
+            // 总体方差 = 平方和的均值 - 均值的平方，舍入误差可能使结果略小于0
+            double variance = count > 0 ? sumSquares / count - avgScore * avgScore : 0.0;
 
-                QMap<QString, QVariant> dataPoint;
-                dataPoint["date"] = dateStr;
-                dataPoint["score"] = avgScore;
-                dataPoint["date_obj"] = examDate;
-                dataPoint["count"] = count;
+            QMap<QString, QVariant> dataPoint;
+            dataPoint["date"] = examDate.toString("yyyy-MM-dd");
+            dataPoint["date_obj"] = examDate;
+            dataPoint["count"] = count;
+            dataPoint["score"] = avgScore;
+            dataPoint["min"] = query->value(3).toDouble();
+            dataPoint["max"] = query->value(4).toDouble();
+            dataPoint["std_dev"] = sqrt(qMax(0.0, variance));
 
-                trendData.append(dataPoint);
-            }
+            trendData.append(dataPoint);
         }
-        qDebug() << "获取课程趋势数据成功，共" << trendData.size() << "条唯一记录";
+        qDebug() << "获取课程趋势数据成功，共" << trendData.size() << "个考试日期";
     } else {
-        qDebug() << "获取课程趋势数据错误:" << query.lastError().text();
+        qDebug() << "获取课程趋势数据错误:" << query->lastError().text();
     }
 
     return trendData;
@@ -525,27 +846,31 @@ QList<QMap<QString, QVariant>> DatabaseManager::getCourseComparison(const QStrin
 {
     QList<QMap<QString, QVariant>> comparisonData;
 
-    QString sql = "SELECT course, AVG(score) as avg_score, COUNT(*) as count FROM scores WHERE 1=1";
+    // 合并各班级的 (班级, 课程) 汇总行，课程名称只在分组之后为每组取一次
+    QString sql = "SELECT co.name, SUM(m.total) / SUM(m.count) as avg_score, SUM(m.count) as count "
+                  "FROM score_summary m JOIN courses co ON co.id = m.course_key WHERE 1=1";
 
     if (!className.isEmpty() && className != "所有班级") {
-        sql += " AND class_name = :class_name";
+        sql += " AND m.class_key = (SELECT id FROM classes WHERE name = :class_name)";
     }
 
-    sql += " GROUP BY course ORDER BY avg_score DESC";
+    sql += " GROUP BY m.course_key ORDER BY avg_score DESC";
 
-    QSqlQuery query(m_database);
-    query.prepare(sql);
+    CachedQuery query(m_pool.statements(), sql);
+    if (!query.isValid()) {
+        return comparisonData;
+    }
 
     if (!className.isEmpty() && className != "所有班级") {
-        query.bindValue(":class_name", className);
+        query->bindValue(":class_name", className);
     }
 
-    if (query.exec()) {
-        while (query.next()) {
+    if (query->exec()) {
+        while (query->next()) {
             QMap<QString, QVariant> courseData;
-            QString course = query.value(0).toString();
-            double avgScore = query.value(1).toDouble();
-            int count = query.value(2).toInt();
+            QString course = query->value(0).toString();
+            double avgScore = query->value(1).toDouble();
+            int count = query->value(2).toInt();
 
             courseData["course"] = course;
             courseData["avg_score"] = avgScore;
@@ -554,22 +879,78 @@ QList<QMap<QString, QVariant>> DatabaseManager::getCourseComparison(const QStrin
             comparisonData.append(courseData);
         }
     } else {
-        qDebug() << "获取课程对比数据错误:" << query.lastError().text();
+        qDebug() << "获取课程对比数据错误:" << query->lastError().text();
     }
 
     return comparisonData;
 }
 
+QFuture<QList<StudentScore>> DatabaseManager::getScoresByFilterAsync(const QString &className, const QString &course,
+                                                                     const QString &keyword)
+{
+    return runQuery<QList<StudentScore>>([this, className, course, keyword](const CancelCheck &cancelled) {
+        return getScoresByFilter(className, course, keyword, cancelled);
+    });
+}
+
+QFuture<QList<StudentScore>> DatabaseManager::getScoresPageAsync(const QString &className, const QString &course,
+                                                                 const QString &keyword, const ScoreCursor &after,
+                                                                 int limit)
+{
+    return runQuery<QList<StudentScore>>([this, className, course, keyword, after, limit](const CancelCheck &) {
+        return getScoresPage(className, course, keyword, after, limit);
+    });
+}
+
+QFuture<QMap<QString, QVariant>> DatabaseManager::calculateStatisticsAsync(const QString &className, const QString &course)
+{
+    return runQuery<QMap<QString, QVariant>>([this, className, course](const CancelCheck &cancelled) {
+        return calculateStatistics(className, course, cancelled);
+    });
+}
+
+QFuture<QList<QMap<QString, QVariant>>> DatabaseManager::getScoreDistributionAsync(const QString &className,
+                                                                                   const QString &course, int bins)
+{
+    return runQuery<QList<QMap<QString, QVariant>>>([this, className, course, bins](const CancelCheck &cancelled) {
+        return getScoreDistribution(className, course, bins, cancelled);
+    });
+}
+
+QFuture<QList<QMap<QString, QVariant>>> DatabaseManager::getCourseTrendDataAsync(const QString &className,
+                                                                                 const QString &course)
+{
+    return runQuery<QList<QMap<QString, QVariant>>>([this, className, course](const CancelCheck &) {
+        return getCourseTrendData(className, course);
+    });
+}
+
+QFuture<QList<QMap<QString, QVariant>>> DatabaseManager::getCourseComparisonAsync(const QString &className)
+{
+    return runQuery<QList<QMap<QString, QVariant>>>([this, className](const CancelCheck &) {
+        return getCourseComparison(className);
+    });
+}
+
+void DatabaseManager::waitForQueries()
+{
+    m_queryPool.waitForDone();
+}
+
 QStringList DatabaseManager::getAllClasses()
 {
     QStringList classes;
-    QSqlQuery query(m_database);
-    query.prepare("SELECT DISTINCT class_name FROM scores ORDER BY class_name");
+    CachedQuery query(m_pool.statements(),
+                      "SELECT name FROM classes c "
+                      "WHERE EXISTS (SELECT 1 FROM score_facts f WHERE f.class_key = c.id) ORDER BY name");
+    if (!query.isValid()) {
+        return classes;
+    }
 
-    if (query.exec()) {
+    if (query->exec()) {
         classes << "所有班级";
-        while (query.next()) {
-            classes << query.value(0).toString();
+        while (query->next()) {
+            classes << query->value(0).toString();
         }
     }
 
@@ -579,13 +960,17 @@ QStringList DatabaseManager::getAllClasses()
 QStringList DatabaseManager::getAllCourses()
 {
     QStringList courses;
-    QSqlQuery query(m_database);
-    query.prepare("SELECT DISTINCT course FROM scores ORDER BY course");
+    CachedQuery query(m_pool.statements(),
+                      "SELECT name FROM courses c "
+                      "WHERE EXISTS (SELECT 1 FROM score_facts f WHERE f.course_key = c.id) ORDER BY name");
+    if (!query.isValid()) {
+        return courses;
+    }
 
-    if (query.exec()) {
+    if (query->exec()) {
         courses << "所有课程";
-        while (query.next()) {
-            courses << query.value(0).toString();
+        while (query->next()) {
+            courses << query->value(0).toString();
         }
     }
 
@@ -595,13 +980,17 @@ QStringList DatabaseManager::getAllCourses()
 QStringList DatabaseManager::getAllStudents()
 {
     QStringList students;
-    QSqlQuery query(m_database);
-    query.prepare("SELECT DISTINCT student_id, student_name FROM scores ORDER BY student_id");
+    CachedQuery query(m_pool.statements(),
+                      "SELECT student_no, name FROM students s "
+                      "WHERE EXISTS (SELECT 1 FROM score_facts f WHERE f.student_key = s.id) ORDER BY student_no");
+    if (!query.isValid()) {
+        return students;
+    }
 
-    if (query.exec()) {
-        while (query.next()) {
-            QString studentId = query.value(0).toString();
-            QString studentName = query.value(1).toString();
+    if (query->exec()) {
+        while (query->next()) {
+            QString studentId = query->value(0).toString();
+            QString studentName = query->value(1).toString();
             students << QString("%1 - %2").arg(studentId).arg(studentName);
         }
     }
@@ -609,91 +998,511 @@ QStringList DatabaseManager::getAllStudents()
     return students;
 }
 
+bool DatabaseManager::parseScoreRow(const QVector<CsvField> &fields, StudentScore &score)
+{
+    if (fields.size() < 6)
+        return false;
+
+    score.studentId = fields[0].toString().trimmed();
+    score.studentName = fields[1].toString().trimmed();
+    score.className = fields[2].toString().trimmed();
+    score.course = fields[3].toString().trimmed();
+
+    bool scoreOk = false;
+    score.score = fields[4].toDouble(&scoreOk);
+    score.examDate = fields[5].toDate();
+
+    return scoreOk && isCompleteScore(score);
+}
+
+bool DatabaseManager::parseScoreValues(const QVector<QString> &values, StudentScore &score)
+{
+    if (values.size() < 6)
+        return false;
+
+    score.studentId = values[0].trimmed();
+    score.studentName = values[1].trimmed();
+    score.className = values[2].trimmed();
+    score.course = values[3].trimmed();
+
+    bool scoreOk = false;
+    score.score = values[4].trimmed().toDouble(&scoreOk);
+
+    // Excel中的日期单元格保存为序列号（1899-12-30起的天数），文本日期按 yyyy-MM-dd 解析
+    QString dateText = values[5].trimmed();
+    bool serialOk = false;
+    double serial = dateText.toDouble(&serialOk);
+    if (serialOk) {
+        score.examDate = QDate(1899, 12, 30).addDays(qint64(serial));
+    } else {
+        score.examDate = QDate::fromString(dateText, "yyyy-MM-dd");
+    }
+
+    return scoreOk && isCompleteScore(score);
+}
+
+bool DatabaseManager::isCompleteScore(const StudentScore &score)
+{
+    // 校验：必填字段非空，日期合法
+    return score.examDate.isValid()
+           && !score.studentId.isEmpty() && !score.studentName.isEmpty()
+           && !score.className.isEmpty() && !score.course.isEmpty();
+}
+
 bool DatabaseManager::importFromCSV(const QString &filePath)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qDebug() << "无法打开文件:" << filePath;
+    return importFromCSV(filePath, connection(), nullptr);
+}
+
+bool DatabaseManager::importFromCSV(const QString &filePath, QSqlDatabase database, JobControl *control)
+{
+    CsvFile file(filePath);
+    if (!file.open()) {
+        qDebug() << "无法打开文件:" << filePath << file.errorString();
         return false;
     }
 
-    QTextStream in(&file);
-    // 跳过标题行
-    QString headerLine = in.readLine();
-    qDebug() << "CSV标题行:" << headerLine;
+    QElapsedTimer timer;
+    timer.start();
 
-    int successCount = 0;
-    int errorCount = 0;
+    // 解析与校验在线程池中并行进行，当前线程独占数据库连接负责写入
+    ScoreBulkWriter writer(database, importBatchSize(), importMode());
+    if (!writer.isValid()) {
+        return false;
+    }
+    // 可取消的后台导入放在一个外层事务里，取消时整体回滚
+    writer.setAtomic(control != nullptr);
 
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        QStringList fields = line.split(",");
+    CsvImportPipeline pipeline(writer);
+    pipeline.setJobControl(control);
+    bool completed = pipeline.run(file);
+    file.close();
 
-        if (fields.size() >= 6) {
-            StudentScore score;
-            score.studentId = fields[0].trimmed();
-            score.studentName = fields[1].trimmed();
-            score.className = fields[2].trimmed();
-            score.course = fields[3].trimmed();
-            score.score = fields[4].trimmed().toDouble();
-            score.examDate = QDate::fromString(fields[5].trimmed(), "yyyy-MM-dd");
+    {
+        QMutexLocker locker(&m_reportMutex);
+        m_lastImportReport = writer.chunkResults();
+    }
 
-            if (addScore(score)) {
-                successCount++;
-            } else {
-                errorCount++;
-            }
+    qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+    qDebug() << "CSV导入结果: 新增 =" << writer.insertedCount() << ", 更新 =" << writer.updatedCount()
+             << ", 未变 =" << writer.unchangedCount() << ", 失败 =" << writer.errorCount()
+             << ", 事务块 =" << writer.chunkResults().size()
+             << ", 耗时 =" << elapsed << "ms"
+             << ", 速度 =" << (writer.successCount() * 1000LL / elapsed) << "行/秒";
+    return completed && writer.successCount() > 0;
+}
+
+bool DatabaseManager::importFromExcel(const QString &filePath)
+{
+    return importFromExcel(filePath, connection(), nullptr);
+}
+
+bool DatabaseManager::importFromExcel(const QString &filePath, QSqlDatabase database, JobControl *control)
+{
+    XlsxReader reader(filePath);
+    if (!reader.open()) {
+        qDebug() << "无法打开Excel文件:" << filePath << reader.errorString();
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 与CSV导入共用同一个批量写入路径
+    ScoreBulkWriter writer(database, importBatchSize(), importMode());
+    if (!writer.isValid()) {
+        return false;
+    }
+    writer.setAtomic(control != nullptr);
+
+    bool headerSkipped = false;
+    bool cancelled = false;
+    qint64 rows = 0;
+
+    bool readOk = reader.readRows([&](const QVector<QString> &cells, int rowNumber, int totalRows) {
+        // 跳过标题行和只有格式没有内容的空行
+        if (cells.isEmpty())
+            return true;
+        if (!headerSkipped) {
+            headerSkipped = true;
+            qDebug() << "Excel标题行:" << cells.size() << "列";
+            return true;
+        }
+
+        StudentScore score;
+        if (parseScoreValues(cells, score)) {
+            writer.append(score);
         } else {
-            qDebug() << "CSV行格式错误:" << line;
-            errorCount++;
+            writer.appendError();
+        }
+        rows++;
+
+        if (control && rows % 1000 == 0) {
+            control->setProgress(rows, totalRows > 0 ? double(rowNumber) / totalRows : 0.0);
+            if (control->isCancelled()) {
+                cancelled = true;
+                return false;
+            }
+        }
+        return true;
+    });
+
+    if (cancelled) {
+        writer.rollbackAll();
+        qDebug() << "Excel导入已取消，已回滚";
+        return false;
+    }
+    if (!readOk) {
+        qDebug() << "Excel读取错误:" << reader.errorString();
+    }
+
+    bool committed = writer.finish();
+    reader.close();
+
+    {
+        QMutexLocker locker(&m_reportMutex);
+        m_lastImportReport = writer.chunkResults();
+    }
+
+    qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+    qDebug() << "Excel导入结果: 新增 =" << writer.insertedCount() << ", 更新 =" << writer.updatedCount()
+             << ", 未变 =" << writer.unchangedCount() << ", 失败 =" << writer.errorCount()
+             << ", 耗时 =" << elapsed << "ms"
+             << ", 速度 =" << (writer.successCount() * 1000LL / elapsed) << "行/秒";
+    return readOk && committed && writer.successCount() > 0;
+}
+
+bool DatabaseManager::exportToCSV(const QString &filePath)
+{
+    return exportToCSV(filePath, QString(), QString(), QString(), connection(), nullptr);
+}
+
+bool DatabaseManager::exportToCSV(const QString &filePath, const QString &className, const QString &course,
+                                  const QString &keyword, QSqlDatabase database, JobControl *control)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "无法创建文件:" << filePath;
+        return false;
+    }
+
+    const QString where = " WHERE 1=1" + filterClause(className, course, keyword);
+
+    // 总行数只用于估算进度
+    qint64 total = 0;
+    if (control) {
+        QSqlQuery countQuery(database);
+        countQuery.prepare("SELECT COUNT(*) FROM scores" + where);
+        bindFilter(countQuery, className, course, keyword);
+        if (countQuery.exec() && countQuery.next()) {
+            total = countQuery.value(0).toLongLong();
         }
     }
 
+    // 只进游标：结果逐行取出，不在内存中缓存已读过的行
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT student_id, student_name, class_name, course, score, exam_date FROM scores"
+                  + where + " ORDER BY exam_date DESC");
+    bindFilter(query, className, course, keyword);
+    if (!query.exec()) {
+        qDebug() << "导出查询错误:" << query.lastError().text();
+        file.close();
+        file.remove();
+        return false;
+    }
+
+    // 带BOM的UTF-8，Excel可以直接正确显示中文
+    file.write("\xEF\xBB\xBF");
+    CsvWriter out(&file);
+    out.writeField(QString("学号"));
+    out.writeField(QString("姓名"));
+    out.writeField(QString("班级"));
+    out.writeField(QString("课程"));
+    out.writeField(QString("成绩"));
+    out.writeField(QString("考试日期"));
+    out.endRow();
+
+    qint64 count = 0;
+    while (query.next()) {
+        out.writeField(query.value(0).toString());
+        out.writeField(query.value(1).toString());
+        out.writeField(query.value(2).toString());
+        out.writeField(query.value(3).toString());
+        out.writeNumber(query.value(4).toDouble(), 2);
+        out.writeField(QDate::fromJulianDay(query.value(5).toLongLong()).toString(Qt::ISODate));
+        out.endRow();
+        count++;
+
+        if (control && count % 1000 == 0) {
+            control->setProgress(count, total > 0 ? double(count) / total : 0.0);
+            if (control->isCancelled()) {
+                // 取消导出时不留下不完整的文件
+                query.finish();
+                file.close();
+                file.remove();
+                qDebug() << "导出已取消";
+                return false;
+            }
+        }
+    }
+
+    bool written = out.flush();
     file.close();
-    qDebug() << "CSV导入结果: 成功 =" << successCount << ", 失败 =" << errorCount;
-    return successCount > 0;
+    if (!written) {
+        qDebug() << "写入文件失败:" << filePath << file.errorString();
+        file.remove();
+        return false;
+    }
+
+    if (control) {
+        control->setProgress(count, 1.0);
+    }
+
+    qDebug() << "导出完成，共" << count << "条记录";
+    return true;
 }
 
-bool DatabaseManager::importFromExcel(const QString &filePath)
+bool DatabaseManager::exportSnapshot(const QString &filePath)
 {
-    // 这里需要安装额外的库来处理Excel文件
-    // 暂时先返回false，或调用CSV导入
-    QMessageBox::information(nullptr, "提示", "Excel导入功能需要额外安装库支持，请使用CSV格式导入");
-    return false;
+    return exportSnapshot(filePath, connection(), nullptr);
 }
 
-bool DatabaseManager::exportToCSV(const QString &filePath)
+bool DatabaseManager::importSnapshot(const QString &filePath)
+{
+    return importSnapshot(filePath, connection(), nullptr);
+}
+
+bool DatabaseManager::exportSnapshot(const QString &filePath, QSqlDatabase database, JobControl *control)
 {
     QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::WriteOnly)) {
         qDebug() << "无法创建文件:" << filePath;
         return false;
     }
 
-    QTextStream out(&file);
-    out << "学号,姓名,班级,课程,成绩,考试日期\n";
+    QElapsedTimer timer;
+    timer.start();
 
-    QList<StudentScore> scores = getAllScores();
-    for (const StudentScore& score : scores) {
-        out << score.studentId << ","
-            << score.studentName << ","
-            << score.className << ","
-            << score.course << ","
-            << QString::number(score.score, 'f', 2) << ","
-            << score.examDate.toString("yyyy-MM-dd") << "\n";
+    qint64 total = 0;
+    if (control) {
+        QSqlQuery countQuery("SELECT COUNT(*) FROM score_facts", database);
+        if (countQuery.next()) {
+            total = countQuery.value(0).toLongLong();
+        }
+    }
+
+    // 数据库中的日期已是儒略日，与快照的日期列编码相同
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT student_id, student_name, class_name, course, score, exam_date "
+                    "FROM scores ORDER BY id")) {
+        qDebug() << "快照导出查询错误:" << query.lastError().text();
+        file.close();
+        file.remove();
+        return false;
     }
 
+    ScoreSnapshotWriter writer(&file);
+    writer.begin();
+
+    StudentScore score;
+    score.id = 0;
+    while (query.next()) {
+        score.studentId = query.value(0).toString();
+        score.studentName = query.value(1).toString();
+        score.className = query.value(2).toString();
+        score.course = query.value(3).toString();
+        score.score = query.value(4).toDouble();
+        QVariant day = query.value(5);
+        score.examDate = day.isNull() ? QDate() : QDate::fromJulianDay(day.toLongLong());
+        if (!writer.append(score))
+            break;
+
+        if (control && writer.rowCount() % 10000 == 0) {
+            control->setProgress(writer.rowCount(), total > 0 ? double(writer.rowCount()) / total : 0.0);
+            if (control->isCancelled()) {
+                query.finish();
+                file.close();
+                file.remove();
+                qDebug() << "快照导出已取消";
+                return false;
+            }
+        }
+    }
+
+    bool written = writer.finish();
     file.close();
-    qDebug() << "导出完成，共" << scores.size() << "条记录";
+    if (!written) {
+        qDebug() << "写入快照失败:" << filePath << file.errorString();
+        file.remove();
+        return false;
+    }
+
+    if (control) {
+        control->setProgress(writer.rowCount(), 1.0);
+    }
+
+    qDebug() << "快照导出完成，共" << writer.rowCount() << "条记录，"
+             << file.size() << "字节，耗时" << timer.elapsed() << "ms";
     return true;
 }
 
+bool DatabaseManager::importSnapshot(const QString &filePath, QSqlDatabase database, JobControl *control)
+{
+    ScoreSnapshotReader reader(filePath);
+    if (!reader.open()) {
+        qDebug() << "无法打开快照:" << filePath << reader.errorString();
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    ScoreBulkWriter writer(database, importBatchSize(), importMode());
+    if (!writer.isValid()) {
+        return false;
+    }
+    // 任何一个数据块校验失败都说明文件损坏，已写入的部分必须一起回滚
+    writer.setAtomic(true);
+
+    QVector<StudentScore> rows;
+    qint64 done = 0;
+    qint64 parseTime = 0;
+    bool completed = true;
+    for (int i = 0; i < reader.blockCount() && completed; ++i) {
+        qint64 started = timer.nsecsElapsed();
+        if (!reader.readBlock(i, rows)) {
+            qDebug() << "快照读取错误:" << reader.errorString();
+            completed = false;
+            break;
+        }
+        parseTime += timer.nsecsElapsed() - started;
+
+        for (const StudentScore &score : rows) {
+            if (isCompleteScore(score)) {
+                writer.append(score);
+            } else {
+                writer.appendError();
+            }
+        }
+        done += rows.size();
+
+        if (control) {
+            control->setProgress(done, reader.rowCount() > 0 ? double(done) / reader.rowCount() : 1.0);
+            if (control->isCancelled()) {
+                qDebug() << "快照导入已取消，已回滚";
+                completed = false;
+            }
+        }
+    }
+
+    if (completed) {
+        completed = writer.finish();
+    } else {
+        writer.rollbackAll();
+    }
+    reader.close();
+
+    {
+        QMutexLocker locker(&m_reportMutex);
+        m_lastImportReport = writer.chunkResults();
+    }
+
+    qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+    qDebug() << "快照导入结果: 新增 =" << writer.insertedCount() << ", 更新 =" << writer.updatedCount()
+             << ", 未变 =" << writer.unchangedCount() << ", 失败 =" << writer.errorCount()
+             << ", 解码耗时 =" << parseTime / 1000000 << "ms"
+             << ", 总耗时 =" << elapsed << "ms";
+    return completed && writer.successCount() > 0;
+}
+
+void DatabaseManager::setImportBatchSize(int batchSize)
+{
+    m_importBatchSize = batchSize > 0 ? batchSize : ScoreBulkWriter::DefaultBatchSize;
+}
+
+int DatabaseManager::importBatchSize() const
+{
+    return m_importBatchSize;
+}
+
+void DatabaseManager::setImportMode(ImportMode mode)
+{
+    m_importMode = mode;
+}
+
+ImportMode DatabaseManager::importMode() const
+{
+    return m_importMode;
+}
+
+QList<ImportChunkResult> DatabaseManager::lastImportReport() const
+{
+    QMutexLocker locker(&m_reportMutex);
+    return m_lastImportReport;
+}
+
+QSqlDatabase DatabaseManager::openWorkerConnection(const QString &connectionName) const
+{
+    QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    database.setDatabaseName(m_pool.databasePath());
+    database.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if (!database.open()) {
+        qDebug() << "后台连接打开失败:" << connectionName << database.lastError().text();
+    } else {
+        m_pool.profile().apply(database);
+    }
+    return database;
+}
+
+void DatabaseManager::closeWorkerConnection(const QString &connectionName)
+{
+    {
+        QSqlDatabase database = QSqlDatabase::database(connectionName, false);
+        if (database.isOpen()) {
+            database.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+QSqlDatabase DatabaseManager::connection()
+{
+    return m_pool.connection();
+}
+
+int DatabaseManager::connectionCount() const
+{
+    return m_pool.connectionCount();
+}
+
+qint64 DatabaseManager::statementCacheHits()
+{
+    return m_pool.statements().hitCount();
+}
+
+qint64 DatabaseManager::statementCacheMisses()
+{
+    return m_pool.statements().missCount();
+}
+
 bool DatabaseManager::isDatabaseConnected() const
 {
-    return m_database.isOpen();
+    return m_pool.hasOpenConnection();
+}
+
+StorageProfile DatabaseManager::storageProfile() const
+{
+    return m_pool.profile();
+}
+
+QStringList DatabaseManager::startupNotices() const
+{
+    return m_startupNotices;
 }
 
 QString DatabaseManager::getDatabasePath() const
 {
-    return m_database.databaseName();
+    return m_pool.databasePath();
 }
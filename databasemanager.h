@@ -8,11 +8,23 @@
 #include <QVariant>
 #include <QList>
 #include <QMap>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QThreadPool>
 #include <QDate>
 #include <QDir>
 #include <QStandardPaths>
 #include <QDebug>
 #include <cmath>
+#include <memory>
+#include <functional>
+#include "csvreader.h"
+#include "connectionpool.h"
+
+class JobControl;
+class DimensionResolver;
 
 struct StudentScore {
     int id;
@@ -24,6 +36,51 @@ struct StudentScore {
     QDate examDate;
 };
 
+// 键集分页的游标：上一页最后一行的 (考试日期, ID)，默认构造的无效游标表示从第一页开始
+struct ScoreCursor {
+    QDate examDate;
+    int id = -1;
+
+    bool isValid() const { return examDate.isValid() && id >= 0; }
+    static ScoreCursor after(const StudentScore& score) { return ScoreCursor{score.examDate, score.id}; }
+};
+
+// 变更日志中一行成绩自某个版本以来的净变化（同一行的多次变更合并为最后的状态）
+struct ScoreChange {
+    enum Operation {
+        Insert = 1,
+        Update = 2,
+        Delete = 3
+    };
+
+    qint64 version;         // 该行最后一次变更的版本号
+    Operation operation;    // 最后一次变更的操作；行已不存在时为 Delete
+    StudentScore score;     // 行的当前内容，Delete 时只有 id 有效
+};
+
+// 批量导入模式
+enum class ImportMode {
+    Append,     // 只插入，自然键（学号, 课程, 考试日期）重复的行计为失败
+    Upsert      // 新行插入，成绩有变化的行更新，完全相同的行跳过
+};
+
+// 批量导入时单个事务块的结果
+// successCount = insertedCount + updatedCount + unchangedCount
+struct ImportChunkResult {
+    int chunkIndex = 0;
+    int rowCount = 0;
+    int successCount = 0;
+    int insertedCount = 0;
+    int updatedCount = 0;
+    int unchangedCount = 0;
+    int errorCount = 0;
+    bool committed = false;
+    QString error;
+};
+
+// 长扫描在逐行读取时定期调用，返回true表示结果已经没有人需要（异步请求被取消），应尽快结束
+typedef std::function<bool()> CancelCheck;
+
 class DatabaseManager : public QObject
 {
     Q_OBJECT
@@ -34,16 +91,57 @@ public:
     bool addScore(const StudentScore& score);
     bool updateScore(int id, const StudentScore& score);
     bool deleteScore(int id);
+    // 批量版本：整批在一个事务中执行，任何一行失败则整批回滚并返回false
+    // updateScores 按每条记录的 id 更新对应的行
+    bool addScores(const QList<StudentScore>& scores);
+    bool updateScores(const QList<StudentScore>& scores);
+    bool deleteScores(const QList<int>& ids);
     QList<StudentScore> getAllScores();
-    QList<StudentScore> getScoresByFilter(const QString& className, const QString& course, const QString& keyword = "");
+    QList<StudentScore> getScoresByFilter(const QString& className, const QString& course, const QString& keyword = "",
+                                          const CancelCheck& cancelled = CancelCheck());
+    // 键集分页：按 (考试日期, ID) 降序返回游标之后的至多 limit 行，筛选条件与 getScoresByFilter 相同。
+    // 从游标位置沿索引继续读，不使用 OFFSET，翻到多深的页代价都只与页大小有关
+    QList<StudentScore> getScoresPage(const QString& className, const QString& course, const QString& keyword,
+                                      const ScoreCursor& after, int limit);
+    QList<StudentScore> getAllScoresPage(const ScoreCursor& after, int limit);
+    // 同样筛选条件下的总行数，与分页查询分开计算；没有关键字时直接由汇总表得到
+    qint64 countScores(const QString& className, const QString& course, const QString& keyword = "");
+
+    // 变更日志：score_facts 的每次插入、修改、删除（含任意连接上的导入）由触发器记录为递增的版本号。
+    // 当前最新的版本号，没有任何变更时为0
+    qint64 latestChangeVersion();
+    // since 之后、直到 until 为止的变更，按成绩行合并、按版本号排序；
+    // 涉及的行超过 limit，或 since 之后的日志已被清理时返回false，调用方应改为整体重新读取
+    bool getChangesSince(qint64 since, qint64 until, int limit, QList<ScoreChange>& changes);
+    // 删除记录时间早于 ChangeRetentionSeconds 的日志。日志由打开同一数据库文件的所有客户端共用，
+    // 不能按某个客户端已应用到的版本清理；版本号不会因此回退
+    void pruneChanges();
 
     // 统计功能
-    QMap<QString, QVariant> calculateStatistics(const QString& className, const QString& course);
-    QList<QMap<QString, QVariant>> getScoreDistribution(const QString& className, const QString& course, int bins = 5);
+    QMap<QString, QVariant> calculateStatistics(const QString& className, const QString& course,
+                                                const CancelCheck& cancelled = CancelCheck());
+    QList<QMap<QString, QVariant>> getScoreDistribution(const QString& className, const QString& course, int bins = 5,
+                                                        const CancelCheck& cancelled = CancelCheck());
     QList<QMap<QString, QVariant>> getTrendData(const QString& studentId, const QString& course);
     QList<QMap<QString, QVariant>> getCourseTrendData(const QString& className, const QString& course); // 新增函数
     QList<QMap<QString, QVariant>> getCourseComparison(const QString& className);
 
+    // 异步版本：在专用的查询线程池上执行（每个线程有自己的连接，见 connection()），
+    // 界面线程不会被大表上的聚合阻塞。
+    // 返回的 future 在开始执行前被 cancel() 时直接跳过查询；已经开始的逐行扫描（筛选结果、成绩分布、四分位数）
+    // 定期检查取消标志并提前结束，不再占用查询线程（例如筛选条件再次变化、旧请求被新请求取代时）
+    QFuture<QList<StudentScore>> getScoresByFilterAsync(const QString& className, const QString& course,
+                                                        const QString& keyword = "");
+    QFuture<QList<StudentScore>> getScoresPageAsync(const QString& className, const QString& course,
+                                                    const QString& keyword, const ScoreCursor& after, int limit);
+    QFuture<QMap<QString, QVariant>> calculateStatisticsAsync(const QString& className, const QString& course);
+    QFuture<QList<QMap<QString, QVariant>>> getScoreDistributionAsync(const QString& className, const QString& course,
+                                                                      int bins = 5);
+    QFuture<QList<QMap<QString, QVariant>>> getCourseTrendDataAsync(const QString& className, const QString& course);
+    QFuture<QList<QMap<QString, QVariant>>> getCourseComparisonAsync(const QString& className);
+    // 等待查询线程池中已提交的查询全部结束（退出前调用）
+    void waitForQueries();
+
     // 获取唯一值列表
     QStringList getAllClasses();
     QStringList getAllCourses();
@@ -54,18 +152,105 @@ public:
     bool importFromExcel(const QString& filePath);
     bool exportToCSV(const QString& filePath);
 
+    // 后台任务版本：在调用线程自己的连接上执行，通过 control 上报进度并响应取消
+    // 导入被取消时整体回滚，导出被取消时删除未写完的文件
+    bool importFromCSV(const QString& filePath, QSqlDatabase database, JobControl* control);
+    bool importFromExcel(const QString& filePath, QSqlDatabase database, JobControl* control);
+    // 导出遵循与 getScoresByFilter 相同的班级/课程/关键字筛选，结果以只进游标流式写出
+    bool exportToCSV(const QString& filePath, const QString& className, const QString& course,
+                     const QString& keyword, QSqlDatabase database, JobControl* control);
+
+    // 二进制列式快照（见 scoresnapshot.h）：导出整张成绩表，导入时整体成功或整体回滚
+    bool exportSnapshot(const QString& filePath);
+    bool importSnapshot(const QString& filePath);
+    bool exportSnapshot(const QString& filePath, QSqlDatabase database, JobControl* control);
+    bool importSnapshot(const QString& filePath, QSqlDatabase database, JobControl* control);
+
+    // 需要自行控制生命周期的独立连接（例如长事务的后台任务），用完须关闭
+    QSqlDatabase openWorkerConnection(const QString& connectionName) const;
+    static void closeWorkerConnection(const QString& connectionName);
+    // 把一行CSV字段转换并校验为成绩记录（学号,姓名,班级,课程,成绩,考试日期），供各导入器共用
+    // 不访问数据库，可在解析线程中调用
+    static bool parseScoreRow(const QVector<CsvField>& fields, StudentScore& score);
+    // 同上，输入为已解码的单元格文本（Excel导入），日期可为Excel日期序列号
+    static bool parseScoreValues(const QVector<QString>& values, StudentScore& score);
+
+    // 批量导入的事务块大小（每块一次提交）
+    void setImportBatchSize(int batchSize);
+    int importBatchSize() const;
+    // 批量导入模式，默认按自然键合并（重复导入同一文件不会产生重复行）
+    void setImportMode(ImportMode mode);
+    ImportMode importMode() const;
+    // 最近一次导入每个事务块的结果
+    QList<ImportChunkResult> lastImportReport() const;
+
+    // 当前线程的数据库连接（由连接池按线程分配），本类所有不带连接参数的方法都使用它，
+    // 因此可以在任意线程调用，各线程的查询互不排队
+    QSqlDatabase connection();
+    int connectionCount() const;
+    // 当前线程连接上预编译语句缓存的命中/未命中次数，用于确认热点路径上不再重复prepare
+    qint64 statementCacheHits();
+    qint64 statementCacheMisses();
+
     // 测试数据库连接
     bool isDatabaseConnected() const;
     QString getDatabasePath() const;
+    StorageProfile storageProfile() const;
+    // 初始化数据库时需要告知用户的情况（例如升级结构时有旧数据未能迁入）
+    QStringList startupNotices() const;
 
 private:
     explicit DatabaseManager(QObject *parent = nullptr);
     DatabaseManager(const DatabaseManager&) = delete;
     DatabaseManager& operator=(const DatabaseManager&) = delete;
 
-    static DatabaseManager* m_instance;
-    QSqlDatabase m_database;
+    // 逐行扫描每读取这么多行检查一次取消标志
+    static const int CancelCheckRows = 1024;
+    // 变更日志的保留时间（秒）：远长于一次读取或一次变更应用所需的时间，
+    // 落后更久的客户端在 getChangesSince 中发现日志缺口后整体重新读取
+    static const int ChangeRetentionSeconds = 600;
+
+    ConnectionPool m_pool;
+    QThreadPool m_queryPool;
+    int m_importBatchSize;
+    ImportMode m_importMode;
+    QAtomicInt m_hasSearchIndex;    // 数据库中是否有 student_search 索引，初始化时检查
+    mutable QMutex m_reportMutex;
+    QList<ImportChunkResult> m_lastImportReport;
+    QStringList m_startupNotices;
     bool createTables();
+
+    // 按班级/课程/关键字拼接WHERE条件（"所有班级"/"所有课程"视为不过滤）并绑定参数
+    QString filterClause(const QString& className, const QString& course, const QString& keyword) const;
+    void bindFilter(QSqlQuery& query, const QString& className, const QString& course, const QString& keyword) const;
+    // 关键字能否使用学号/姓名的 trigram 索引（索引存在且关键字至少3个字符）
+    bool useSearchIndex(const QString& keyword) const;
+    static bool isCompleteScore(const StudentScore& score);
+    // 单行写入，不管理事务；id < 0 时插入，否则更新该行
+    bool writeScore(DimensionResolver& dimensions, const StudentScore& score, int id);
+    bool removeScore(int id);
+    // 在当前线程的连接上以一个事务执行 work，返回false时回滚
+    bool runInTransaction(const char* operation, int rowCount, const std::function<bool()>& work);
+    // 读取 "id, student_id, student_name, class_name, course, score, exam_date" 顺序的一行
+    static StudentScore readScore(const QSqlQuery& query);
+
+    // 把 function 提交到查询线程池，结果通过返回的 future 送出；
+    // function 的参数为检查 future 是否已被取消的 CancelCheck
+    template <typename T, typename Function>
+    QFuture<T> runQuery(Function function)
+    {
+        auto promise = std::make_shared<QFutureInterface<T>>();
+        promise->reportStarted();
+        QFuture<T> future = promise->future();
+        m_queryPool.start([promise, function]() {
+            if (!promise->isCanceled()) {
+                CancelCheck cancelled = [promise]() { return promise->isCanceled(); };
+                promise->reportResult(function(cancelled));
+            }
+            promise->reportFinished();
+        });
+        return future;
+    }
 };
 
 #endif // DATABASEMANAGER_H
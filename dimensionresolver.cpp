@@ -0,0 +1,99 @@
+#include "dimensionresolver.h"
+#include "databasemanager.h"
+#include <QSqlError>
+#include <QDebug>
+
+DimensionResolver::DimensionResolver(StatementCache &statements)
+    : m_statements(statements)
+{
+}
+
+bool DimensionResolver::resolve(const StudentScore &score, Keys &keys)
+{
+    keys.student = resolveStudent(score.studentId, score.studentName);
+    keys.className = keys.student > 0 ? resolveName("classes", m_classes, score.className) : 0;
+    keys.course = keys.className > 0 ? resolveName("courses", m_courses, score.course) : 0;
+    return keys.student > 0 && keys.className > 0 && keys.course > 0;
+}
+
+void DimensionResolver::clear()
+{
+    m_students.clear();
+    m_classes.clear();
+    m_courses.clear();
+}
+
+QString DimensionResolver::lastError() const
+{
+    return m_lastError;
+}
+
+qint64 DimensionResolver::resolveStudent(const QString &studentNo, const QString &name)
+{
+    auto it = m_students.constFind(studentNo);
+    if (it != m_students.constEnd() && it->name == name)
+        return it->key;
+
+    // 学号已存在时只在姓名不同时才改写，姓名相同的重复导入不产生写操作
+    {
+        CachedQuery upsert(m_statements,
+                           "INSERT INTO students (student_no, name) VALUES (?, ?) "
+                           "ON CONFLICT(student_no) DO UPDATE SET name = excluded.name "
+                           "WHERE name <> excluded.name");
+        if (!upsert.isValid())
+            return 0;
+        upsert->bindValue(0, studentNo);
+        upsert->bindValue(1, name);
+        if (!upsert->exec()) {
+            m_lastError = upsert->lastError().text();
+            return 0;
+        }
+    }
+
+    qint64 key = it != m_students.constEnd()
+                     ? it->key
+                     : selectKey("SELECT id FROM students WHERE student_no = ?", studentNo);
+    if (key > 0)
+        m_students.insert(studentNo, StudentEntry{key, name});
+    return key;
+}
+
+qint64 DimensionResolver::resolveName(const QString &table, QHash<QString, qint64> &cache, const QString &name)
+{
+    auto it = cache.constFind(name);
+    if (it != cache.constEnd())
+        return it.value();
+
+    {
+        CachedQuery insert(m_statements, QString("INSERT OR IGNORE INTO %1 (name) VALUES (?)").arg(table));
+        if (!insert.isValid())
+            return 0;
+        insert->bindValue(0, name);
+        if (!insert->exec()) {
+            m_lastError = insert->lastError().text();
+            return 0;
+        }
+    }
+
+    qint64 key = selectKey(QString("SELECT id FROM %1 WHERE name = ?").arg(table), name);
+    if (key > 0)
+        cache.insert(name, key);
+    return key;
+}
+
+qint64 DimensionResolver::selectKey(const QString &sql, const QString &value)
+{
+    CachedQuery select(m_statements, sql);
+    if (!select.isValid())
+        return 0;
+    select->bindValue(0, value);
+    if (!select->exec()) {
+        m_lastError = select->lastError().text();
+        return 0;
+    }
+    if (!select->next()) {
+        m_lastError = QString("维度键不存在: %1").arg(value);
+        return 0;
+    }
+    return select->value(0).toLongLong();
+}
@@ -0,0 +1,47 @@
+#ifndef DIMENSIONRESOLVER_H
+#define DIMENSIONRESOLVER_H
+
+#include <QHash>
+#include <QString>
+#include "statementcache.h"
+
+struct StudentScore;
+
+// 把成绩记录中的学号/姓名、班级、课程解析为维度表（students / classes / courses）的整数键，
+// 不存在时插入；学生姓名变化时更新维度表中的姓名。
+// 已解析的键缓存在内存中，批量导入时每个学生、班级、课程只访问一次数据库。
+// 所在事务回滚后新插入的维度行随之消失，必须调用 clear() 丢弃缓存
+class DimensionResolver
+{
+public:
+    struct Keys {
+        qint64 student = 0;
+        qint64 className = 0;
+        qint64 course = 0;
+    };
+
+    explicit DimensionResolver(StatementCache &statements);
+
+    bool resolve(const StudentScore &score, Keys &keys);
+    void clear();
+
+    QString lastError() const;
+
+private:
+    struct StudentEntry {
+        qint64 key;
+        QString name;
+    };
+
+    qint64 resolveStudent(const QString &studentNo, const QString &name);
+    qint64 resolveName(const QString &table, QHash<QString, qint64> &cache, const QString &name);
+    qint64 selectKey(const QString &sql, const QString &value);
+
+    StatementCache &m_statements;
+    QHash<QString, StudentEntry> m_students;
+    QHash<QString, qint64> m_classes;
+    QHash<QString, qint64> m_courses;
+    QString m_lastError;
+};
+
+#endif // DIMENSIONRESOLVER_H
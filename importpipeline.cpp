@@ -0,0 +1,254 @@
+#include "importpipeline.h"
+#include "scorebulkwriter.h"
+#include "jobcontrol.h"
+#include <QThread>
+#include <QThreadPool>
+#include <QMutexLocker>
+#include <QtConcurrent>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+// 每个解析块至少1MB，避免小文件被切得过碎
+const qint64 MinChunkBytes = 1 << 20;
+
+} // namespace
+
+BoundedBatchQueue::BoundedBatchQueue(int capacity)
+    : m_next(0, 0)
+    , m_capacity(capacity > 0 ? capacity : 1)
+    , m_closed(false)
+{
+}
+
+bool BoundedBatchQueue::push(ScoreBatch &&batch)
+{
+    QMutexLocker locker(&m_mutex);
+    BatchKey key(batch.chunk, batch.sequence);
+    while (!m_closed && m_pending.size() >= m_capacity && key != m_next)
+        m_notFull.wait(&m_mutex);
+
+    if (m_closed)
+        return false;
+
+    m_pending.insert(key, std::move(batch));
+    if (key == m_next)
+        m_notEmpty.wakeOne();
+    return true;
+}
+
+bool BoundedBatchQueue::pop(ScoreBatch &batch)
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_closed && !m_pending.contains(m_next))
+        m_notEmpty.wait(&m_mutex);
+
+    auto it = m_pending.find(m_next);
+    if (it == m_pending.end())
+        return false;
+
+    batch = std::move(it.value());
+    m_pending.erase(it);
+    m_next = batch.last ? BatchKey(m_next.first + 1, 0) : BatchKey(m_next.first, m_next.second + 1);
+    // 等待的生产者各自判断自己是不是下一批，须全部唤醒
+    m_notFull.wakeAll();
+    return true;
+}
+
+void BoundedBatchQueue::close()
+{
+    QMutexLocker locker(&m_mutex);
+    m_closed = true;
+    m_notFull.wakeAll();
+    m_notEmpty.wakeAll();
+}
+
+CsvImportPipeline::CsvImportPipeline(ScoreBulkWriter &writer)
+    : m_writer(writer)
+    , m_threadCount(qMax(1, QThread::idealThreadCount()))
+    , m_batchRows(2000)
+    , m_control(nullptr)
+{
+}
+
+void CsvImportPipeline::setThreadCount(int threadCount)
+{
+    m_threadCount = threadCount > 0 ? threadCount : qMax(1, QThread::idealThreadCount());
+}
+
+void CsvImportPipeline::setBatchRows(int batchRows)
+{
+    m_batchRows = batchRows > 0 ? batchRows : 2000;
+}
+
+void CsvImportPipeline::setJobControl(JobControl *control)
+{
+    m_control = control;
+}
+
+int CsvImportPipeline::parsedRows() const
+{
+    return m_parsedRows.loadRelaxed();
+}
+
+const char *CsvImportPipeline::findRowBoundary(const char *from, const char *target, const char *end)
+{
+    // 统计 from 到 target 之间的引号个数，判断 target 是否落在引号字段内部
+    bool inQuotes = false;
+    const char *p = from;
+    while (p < target) {
+        const char *quote = static_cast<const char *>(memchr(p, '"', target - p));
+        if (!quote)
+            break;
+        inQuotes = !inQuotes;
+        p = quote + 1;
+    }
+
+    // 从 target 开始找第一个不在引号内的换行符
+    for (p = target; p < end; ++p) {
+        if (*p == '"') {
+            inQuotes = !inQuotes;
+        } else if (*p == '\n' && !inQuotes) {
+            return p + 1;
+        }
+    }
+    return end;
+}
+
+void CsvImportPipeline::parseChunk(int chunk, const char *begin, const char *end, BoundedBatchQueue &queue)
+{
+    CsvTokenizer tokenizer(begin, end);
+    QVector<CsvField> fields;
+
+    ScoreBatch batch;
+    batch.chunk = chunk;
+    batch.rows.reserve(m_batchRows);
+    int parsed = 0;
+    bool stopped = false;
+    const char *reported = begin;
+
+    while (tokenizer.readRow(fields)) {
+        StudentScore score;
+        if (DatabaseManager::parseScoreRow(fields, score)) {
+            batch.rows.append(score);
+        } else {
+            batch.errorPositions.append(batch.size());
+        }
+        parsed++;
+
+        if (batch.size() >= m_batchRows) {
+            m_parsedBytes.fetchAndAddRelaxed(tokenizer.position() - reported);
+            reported = tokenizer.position();
+            int sequence = batch.sequence;
+            if (!queue.push(std::move(batch)) || (m_control && m_control->isCancelled())) {
+                stopped = true;
+                break;
+            }
+            batch = ScoreBatch();
+            batch.chunk = chunk;
+            batch.sequence = sequence + 1;
+            batch.rows.reserve(m_batchRows);
+        }
+    }
+
+    // 块内最后一批即使为空也要送出，写入线程靠它转到下一块
+    if (!stopped) {
+        m_parsedBytes.fetchAndAddRelaxed(tokenizer.position() - reported);
+        batch.last = true;
+        queue.push(std::move(batch));
+    }
+
+    m_parsedRows.fetchAndAddRelaxed(parsed);
+}
+
+bool CsvImportPipeline::run(const CsvFile &file)
+{
+    const char *begin = file.begin();
+    const char *end = file.end();
+    m_parsedRows.storeRelaxed(0);
+    m_parsedBytes.storeRelaxed(0);
+
+    // 跳过标题行
+    {
+        CsvTokenizer header(begin, end);
+        QVector<CsvField> fields;
+        if (header.readRow(fields)) {
+            qDebug() << "CSV标题行:" << fields.size() << "列";
+        }
+        begin = header.position();
+    }
+
+    // 按行边界切块，块数为线程数的若干倍以便负载均衡
+    QVector<QPair<const char *, const char *>> chunks;
+    qint64 total = end - begin;
+    qint64 chunkBytes = qMax(MinChunkBytes, total / (m_threadCount * 4) + 1);
+    const char *chunkBegin = begin;
+    while (chunkBegin < end) {
+        const char *target = chunkBegin + qMin(chunkBytes, qint64(end - chunkBegin));
+        const char *chunkEnd = target < end ? findRowBoundary(chunkBegin, target, end) : end;
+        chunks.append(qMakePair(chunkBegin, chunkEnd));
+        chunkBegin = chunkEnd;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMin(m_threadCount, qMax(1, int(chunks.size()))));
+
+    BoundedBatchQueue queue(m_threadCount * 2);
+    QAtomicInt remaining(chunks.size());
+    if (chunks.isEmpty())
+        queue.close();
+
+    // 线程池按提交顺序启动任务，写入线程等待的总是已经在解析的最靠前的块
+    for (int i = 0; i < chunks.size(); ++i) {
+        const auto chunk = chunks.at(i);
+        QtConcurrent::run(&pool, [this, i, chunk, &queue, &remaining]() {
+            parseChunk(i, chunk.first, chunk.second, queue);
+            if (!remaining.deref())
+                queue.close();
+        });
+    }
+
+    // 当前线程是唯一的写入者，只有它使用数据库连接
+    ScoreBatch batch;
+    qint64 rowsWritten = 0;
+    bool cancelled = false;
+    while (queue.pop(batch)) {
+        // 按文件中的原始顺序写入，解析失败的行也计入所在的事务块
+        int row = 0;
+        int error = 0;
+        for (int position = 0; position < batch.size(); ++position) {
+            if (error < batch.errorPositions.size() && batch.errorPositions.at(error) == position) {
+                m_writer.appendError();
+                error++;
+            } else {
+                m_writer.append(batch.rows.at(row++));
+            }
+        }
+
+        if (m_control) {
+            rowsWritten += batch.size();
+            m_control->setProgress(rowsWritten, total > 0 ? double(m_parsedBytes.loadRelaxed()) / total : 1.0);
+            if (m_control->isCancelled()) {
+                // 关闭队列让解析线程尽快退出
+                cancelled = true;
+                queue.close();
+                break;
+            }
+        }
+    }
+
+    pool.waitForDone();
+
+    if (cancelled) {
+        m_writer.rollbackAll();
+        qDebug() << "导入已取消，已回滚";
+        return false;
+    }
+
+    bool committed = m_writer.finish();
+
+    qDebug() << "导入流水线:" << chunks.size() << "个数据块," << pool.maxThreadCount() << "个解析线程,"
+             << parsedRows() << "行";
+    return committed;
+}
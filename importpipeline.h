@@ -0,0 +1,89 @@
+#ifndef IMPORTPIPELINE_H
+#define IMPORTPIPELINE_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QMap>
+#include <QPair>
+#include <QVector>
+#include <QAtomicInt>
+#include "databasemanager.h"
+#include "csvreader.h"
+
+class ScoreBulkWriter;
+class JobControl;
+
+// 解析线程产出的一批已校验记录
+// chunk、sequence 为所在数据块及块内序号，last 标记块内最后一批（可以为空），写入线程据此按文件顺序重排
+struct ScoreBatch {
+    QVector<StudentScore> rows;
+    QVector<int> errorPositions;    // 解析失败的行在本批中的位置（与成功的行一起按文件顺序计数）
+    int chunk = 0;
+    int sequence = 0;
+    bool last = false;
+
+    int size() const { return rows.size() + errorPositions.size(); }
+};
+
+// 有界重排队列：解析线程按完成先后写入，唯一的数据库写入线程按 (数据块, 块内序号) 的文件顺序读取
+// 缓存的批次达到上限时，除了写入线程正在等待的那一批，其余解析线程都阻塞，
+// 防止解析速度远超写入速度时内存无限增长；等待的那一批总能进入，因此不会死锁
+class BoundedBatchQueue
+{
+public:
+    explicit BoundedBatchQueue(int capacity);
+
+    // 队列已关闭时返回false，批次被丢弃
+    bool push(ScoreBatch &&batch);
+    // 按文件顺序取下一批；下一批尚未到达时等待，已关闭且没有下一批时返回false
+    bool pop(ScoreBatch &batch);
+    // 不再有新的批次（所有生产者结束或导入被取消）
+    void close();
+
+private:
+    typedef QPair<int, int> BatchKey;
+
+    QMutex m_mutex;
+    QWaitCondition m_notFull;
+    QWaitCondition m_notEmpty;
+    QMap<BatchKey, ScoreBatch> m_pending;
+    BatchKey m_next;
+    int m_capacity;
+    bool m_closed;
+};
+
+// 分阶段CSV导入：
+// 1. 按行边界（识别引号内换行）把映射后的文件切分为若干块
+// 2. 线程池并行分词、转换、校验，每块产出若干 ScoreBatch
+// 3. 调用线程作为唯一写入者，从有界队列按文件顺序取批次交给 ScoreBulkWriter，
+//    同一文件中自然键重复的行在 Upsert 模式下总是最后一行生效，各事务块对应文件中连续的行
+class CsvImportPipeline
+{
+public:
+    explicit CsvImportPipeline(ScoreBulkWriter &writer);
+
+    // 解析线程数，默认等于CPU核数
+    void setThreadCount(int threadCount);
+    // 每个 ScoreBatch 的行数
+    void setBatchRows(int batchRows);
+    // 可选：上报进度并响应取消，取消时写入器整体回滚
+    void setJobControl(JobControl *control);
+
+    // 跳过标题行后导入整个文件，阻塞直到全部写入；被取消时返回false
+    bool run(const CsvFile &file);
+
+    int parsedRows() const;
+
+private:
+    static const char *findRowBoundary(const char *from, const char *target, const char *end);
+    void parseChunk(int chunk, const char *begin, const char *end, BoundedBatchQueue &queue);
+
+    ScoreBulkWriter &m_writer;
+    int m_threadCount;
+    int m_batchRows;
+    JobControl *m_control;
+    QAtomicInt m_parsedRows;
+    QAtomicInteger<qint64> m_parsedBytes;
+};
+
+#endif // IMPORTPIPELINE_H
@@ -0,0 +1,48 @@
+#ifndef JOBCONTROL_H
+#define JOBCONTROL_H
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+// 后台任务控制块：工作线程写入进度、查询取消标志，界面线程定时读取
+// 所有成员都是原子操作，不需要加锁
+class JobControl
+{
+public:
+    JobControl()
+        : m_cancelled(0)
+        , m_rowsDone(0)
+        , m_permille(0)
+    {
+    }
+
+    void reset()
+    {
+        m_cancelled.storeRelease(0);
+        m_rowsDone.storeRelease(0);
+        m_permille.storeRelease(0);
+    }
+
+    void cancel() { m_cancelled.storeRelease(1); }
+    bool isCancelled() const { return m_cancelled.loadAcquire() != 0; }
+
+    // rowsDone为已处理行数，fraction为0~1的完成比例（导入按字节、导出按行数估算）
+    void setProgress(qint64 rowsDone, double fraction)
+    {
+        m_rowsDone.storeRelease(rowsDone);
+        m_permille.storeRelease(qBound(0, int(fraction * 1000), 1000));
+    }
+
+    qint64 rowsDone() const { return m_rowsDone.loadAcquire(); }
+    double fraction() const { return m_permille.loadAcquire() / 1000.0; }
+
+private:
+    JobControl(const JobControl&) = delete;
+    JobControl& operator=(const JobControl&) = delete;
+
+    QAtomicInt m_cancelled;
+    QAtomicInteger<qint64> m_rowsDone;
+    QAtomicInt m_permille;
+};
+
+#endif // JOBCONTROL_H
@@ -16,11 +16,64 @@
 #include <QTextDocument>
 #include <QDateTimeAxis>
 #include <QDateTime>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QHeaderView>
+#include <QSignalBlocker>
+
+namespace {
+
+// 搜索框停止输入多久后开始搜索
+const int SearchDebounceMs = 250;
+
+// 新请求取代观察器上尚未返回的旧请求：旧 future 若还没开始执行就不再执行，
+// 观察器改为跟踪新 future，旧请求的结果不会再送到界面
+template <typename T>
+void replaceFuture(QFutureWatcher<T> &watcher, const QFuture<T> &future)
+{
+    watcher.cancel();
+    watcher.setFuture(future);
+}
+
+// 重建下拉框的选项，期间不发出 currentTextChanged；原来选中的项仍在时保持选中，
+// 返回选中的文本是否因此改变（原来的项已不存在）
+bool setComboItems(QComboBox *combo, const QStringList &items)
+{
+    QString current = combo->currentText();
+    QSignalBlocker blocker(combo);
+    combo->clear();
+    combo->addItems(items);
+    int index = combo->findText(current);
+    combo->setCurrentIndex(index >= 0 ? index : 0);
+    return combo->currentText() != current;
+}
+
+// 观察器当前跟踪的请求已完成且未被取消（过期的完成通知到达时返回false）
+template <typename T>
+bool hasFreshResult(const QFutureWatcher<T> &watcher)
+{
+    return watcher.isFinished() && !watcher.isCanceled() && watcher.future().resultCount() > 0;
+}
+
+template <typename T>
+void cancelAndWait(QFutureWatcher<T> &watcher)
+{
+    watcher.cancel();
+    watcher.waitForFinished();
+}
+
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , m_scoreModel(new ScoreModel(this))
+    , m_bulkJob(nullptr)
+    , m_jobProgressBar(nullptr)
+    , m_btnCancelJob(nullptr)
+    , m_statsRequested(false)
+    , m_filterVersion(0)
+    , m_filterInMemory(false)
 {
     ui->setupUi(this);
 
@@ -36,6 +89,15 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // 查询线程结束前不能销毁界面
+    m_scoreModel->cancelSortLoad();
+    cancelAndWait(m_filterWatcher);
+    cancelAndWait(m_statsWatcher);
+    cancelAndWait(m_distributionWatcher);
+    cancelAndWait(m_trendWatcher);
+    cancelAndWait(m_comparisonWatcher);
+    cancelAndWait(m_reportWatcher);
+    DatabaseManager::instance()->waitForQueries();
     delete ui;
 }
 
@@ -43,8 +105,12 @@ void MainWindow::setupUI()
 {
     // 设置表格模型
     ui->tableView->setModel(m_scoreModel);
-    ui->tableView->setSelectionMode(QAbstractItemView::SingleSelection);
+    // 可多选：Ctrl/Shift 选中多行后批量删除或批量修改班级和考试日期
+    ui->tableView->setSelectionMode(QAbstractItemView::ExtendedSelection);
     ui->tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    // 点击列标题排序；初始不显示排序标志，表格按考试日期降序分页读取（点击“刷新”恢复）
+    ui->tableView->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+    ui->tableView->setSortingEnabled(true);
 
     // 设置列宽
     ui->tableView->setColumnWidth(0, 50);   // ID
@@ -65,17 +131,32 @@ void MainWindow::setupUI()
     connect(ui->tableView->selectionModel(), &QItemSelectionModel::selectionChanged,
             this, &MainWindow::loadSelectedScoreToForm);
 
+    // 状态栏中的后台任务进度条和取消按钮，仅在任务运行时显示
+    m_jobProgressBar = new QProgressBar(this);
+    m_jobProgressBar->setRange(0, 1000);
+    m_jobProgressBar->setMaximumWidth(200);
+    m_jobProgressBar->setTextVisible(false);
+    m_jobProgressBar->hide();
+    ui->statusbar->addPermanentWidget(m_jobProgressBar);
+
+    m_btnCancelJob = new QPushButton("取消", this);
+    m_btnCancelJob->hide();
+    ui->statusbar->addPermanentWidget(m_btnCancelJob);
+    connect(m_btnCancelJob, &QPushButton::clicked, this, &MainWindow::cancelBulkJob);
+
+    setupQueryWatchers();
+
     // 初始刷新
     refreshFilterCombos();
 
     // 显示初始记录数
-    ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->rowCount()));
+    ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->totalCount()));
 }
 
 void MainWindow::setupDatabase()
 {
-    // 直接连接到指定数据库文件
-    QString dbPath = "C:/Users/bill/Desktop/student_scores.db";
+    // 数据库位置由存储配置决定（配置文件或 SGS_DB_PATH 环境变量）
+    QString dbPath = DatabaseManager::instance()->getDatabasePath();
 
     // 检查数据库文件是否存在
     QFileInfo dbFile(dbPath);
@@ -94,11 +175,18 @@ void MainWindow::setupDatabase()
         // 显示数据库信息
         qDebug() << "数据库连接成功，路径:" << actualDbPath;
 
-        // 刷新数据模型
+        for (const QString &notice : DatabaseManager::instance()->startupNotices()) {
+            QMessageBox::warning(this, "数据库升级", QString("%1\n\n数据库文件: %2").arg(notice, actualDbPath));
+        }
+
+        // 刷新数据模型；初始化之前由下拉框触发的筛选请求作废
+        m_searchTimer.stop();
+        m_filterWatcher.cancel();
         m_scoreModel->refreshData();
-        ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->rowCount()));
+        ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->totalCount()));
 
-        qDebug() << "数据库初始化完成，加载了" << m_scoreModel->rowCount() << "条记录";
+        qDebug() << "数据库初始化完成，共" << m_scoreModel->totalCount() << "条记录，已读取第一页"
+                 << m_scoreModel->rowCount() << "条";
 
         // 如果数据库为空，显示提示
         if (m_scoreModel->rowCount() == 0) {
@@ -119,6 +207,56 @@ void MainWindow::setupDatabase()
     }
 }
 
+void MainWindow::setupQueryWatchers()
+{
+    // 查询结果在界面线程中送达，只处理观察器当前跟踪的请求
+    m_searchTimer.setSingleShot(true);
+    m_searchTimer.setInterval(SearchDebounceMs);
+    connect(&m_searchTimer, &QTimer::timeout, this, &MainWindow::startSearch);
+
+    connect(&m_filterWatcher, &QFutureWatcher<QList<StudentScore>>::finished, this, [this]() {
+        if (!hasFreshResult(m_filterWatcher))
+            return;
+        if (m_filterInMemory) {
+            m_scoreModel->setNarrowedRows(m_filterClass, m_filterCourse, m_filterKeyword,
+                                          m_filterWatcher.result(), m_filterVersion);
+        } else {
+            m_scoreModel->setFirstPage(m_filterClass, m_filterCourse, m_filterKeyword,
+                                       m_filterWatcher.result(), m_filterVersion);
+        }
+        ui->labelRecordCount->setText(QString("筛选记录数: %1").arg(m_scoreModel->totalCount()));
+    });
+    // 第一次点击列标题排序时全部行在后台读取，读取期间表格仍可滚动
+    connect(m_scoreModel, &ScoreModel::sortLoadStarted, this, [this]() {
+        updateStatusBar("正在读取全部记录以排序...");
+    });
+    connect(m_scoreModel, &ScoreModel::sortLoadFinished, this, [this]() {
+        updateStatusBar(QString("已排序 %1 条记录").arg(m_scoreModel->totalCount()));
+    });
+    connect(&m_statsWatcher, &QFutureWatcher<QMap<QString, QVariant>>::finished, this, [this]() {
+        if (hasFreshResult(m_statsWatcher)) {
+            showStatistics(m_statsWatcher.result());
+            updateStatusBar("统计计算完成");
+        }
+    });
+    connect(&m_distributionWatcher, &QFutureWatcher<QList<QMap<QString, QVariant>>>::finished, this, [this]() {
+        if (hasFreshResult(m_distributionWatcher))
+            showHistogramChart(m_distributionWatcher.result());
+    });
+    connect(&m_trendWatcher, &QFutureWatcher<QList<QMap<QString, QVariant>>>::finished, this, [this]() {
+        if (hasFreshResult(m_trendWatcher))
+            showTrendChart(m_trendWatcher.result());
+    });
+    connect(&m_comparisonWatcher, &QFutureWatcher<QList<QMap<QString, QVariant>>>::finished, this, [this]() {
+        if (hasFreshResult(m_comparisonWatcher))
+            showComparisonChart(m_comparisonWatcher.result());
+    });
+    connect(&m_reportWatcher, &QFutureWatcher<QMap<QString, QVariant>>::finished, this, [this]() {
+        if (hasFreshResult(m_reportWatcher))
+            showReport(m_reportWatcher.result());
+    });
+}
+
 void MainWindow::setupCharts()
 {
     // 初始化图表视图
@@ -255,11 +393,15 @@ void MainWindow::on_actionReports_triggered()
 void MainWindow::on_actionAbout_triggered()
 {
     // 显示关于对话框
+    DatabaseManager *manager = DatabaseManager::instance();
     QMessageBox::about(this, "关于学生成绩与分析系统",
-                       "<h2>学生成绩与分析系统</h2>"
-                       "<p>版本: 1.0.0</p>"
-                       "<p>数据库路径: C:/Users/bill/Desktop/student_scores.db</p>"
-                       "<p>开发: 慕容显欢 2023414290427</p>");
+                       QString("<h2>学生成绩与分析系统</h2>"
+                               "<p>版本: 1.0.0</p>"
+                               "<p>数据库路径: %1</p>"
+                               "<p>存储配置: %2</p>"
+                               "<p>开发: 慕容显欢 2023414290427</p>")
+                           .arg(manager->getDatabasePath().toHtmlEscaped(),
+                                manager->storageProfile().name));
 }
 
 // ==================== 原有的按钮槽函数 ====================
@@ -290,15 +432,15 @@ void MainWindow::on_btnAdd_clicked()
     score.examDate = ui->dateExam->date();
 
     if (DatabaseManager::instance()->addScore(score)) {
-        // 刷新数据
-        m_scoreModel->refreshData();
+        // 只把新增的行加入表格
+        m_scoreModel->applyChanges();
         clearForm();
         refreshFilterCombos();
         updateStatusBar("添加成绩成功");
-        ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->rowCount()));
+        ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->totalCount()));
 
         // 如果这是第一条记录，更新图表
-        if (m_scoreModel->rowCount() == 1) {
+        if (m_scoreModel->totalCount() == 1) {
             setupCharts();
         }
     } else {
@@ -314,6 +456,11 @@ void MainWindow::on_btnUpdate_clicked()
         return;
     }
 
+    if (selected.size() > 1) {
+        updateSelectedScores(selected);
+        return;
+    }
+
     int row = selected.first().row();
     StudentScore oldScore = m_scoreModel->getScoreAt(row);
 
@@ -331,10 +478,10 @@ void MainWindow::on_btnUpdate_clicked()
     newScore.examDate = ui->dateExam->date();
 
     if (DatabaseManager::instance()->updateScore(oldScore.id, newScore)) {
-        m_scoreModel->refreshData();
+        m_scoreModel->applyChanges();
         clearForm();
         updateStatusBar("更新成绩成功");
-        ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->rowCount()));
+        ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->totalCount()));
     } else {
         QMessageBox::warning(this, "错误", "更新成绩失败");
     }
@@ -348,6 +495,11 @@ void MainWindow::on_btnDelete_clicked()
         return;
     }
 
+    if (selected.size() > 1) {
+        deleteSelectedScores(selected);
+        return;
+    }
+
     int row = selected.first().row();
     StudentScore score = m_scoreModel->getScoreAt(row);
 
@@ -363,28 +515,109 @@ void MainWindow::on_btnDelete_clicked()
 
     if (reply == QMessageBox::Yes) {
         if (DatabaseManager::instance()->deleteScore(score.id)) {
-            m_scoreModel->refreshData();
+            m_scoreModel->applyChanges();
             clearForm();
             refreshFilterCombos();
             updateStatusBar("删除成绩成功");
-            ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->rowCount()));
+            ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->totalCount()));
         } else {
             QMessageBox::warning(this, "错误", "删除成绩失败");
         }
     }
 }
 
+void MainWindow::updateSelectedScores(const QModelIndexList &selected)
+{
+    // 多行时只修改班级和考试日期（例如整班调整考试日期），学号、姓名、课程和成绩保持不变
+    QString className = ui->comboClass->currentText();
+    QDate examDate = ui->dateExam->date();
+    QMessageBox::StandardButton reply;
+    reply = QMessageBox::question(this, "确认批量修改",
+                                  QString("确定要把选中的 %1 条记录的班级改为 %2、考试日期改为 %3 吗？")
+                                      .arg(selected.size()).arg(className, examDate.toString("yyyy-MM-dd")),
+                                  QMessageBox::Yes | QMessageBox::No);
+    if (reply != QMessageBox::Yes) {
+        return;
+    }
+
+    QList<StudentScore> scores;
+    scores.reserve(selected.size());
+    for (const QModelIndex &index : selected) {
+        StudentScore score = m_scoreModel->getScoreAt(index.row());
+        if (score.id == -1) {
+            continue;
+        }
+        score.className = className;
+        score.examDate = examDate;
+        scores.append(score);
+    }
+
+    if (DatabaseManager::instance()->updateScores(scores)) {
+        m_scoreModel->applyChanges();
+        clearForm();
+        refreshFilterCombos();
+        updateStatusBar(QString("已更新 %1 条成绩").arg(scores.size()));
+        ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->totalCount()));
+    } else {
+        QMessageBox::warning(this, "错误", "批量更新失败，所有修改已撤销。\n"
+                                         "同一学生同一课程在同一考试日期只能有一条成绩。");
+    }
+}
+
+void MainWindow::deleteSelectedScores(const QModelIndexList &selected)
+{
+    QMessageBox::StandardButton reply;
+    reply = QMessageBox::question(this, "确认删除",
+                                  QString("确定要删除选中的 %1 条成绩吗？").arg(selected.size()),
+                                  QMessageBox::Yes | QMessageBox::No);
+    if (reply != QMessageBox::Yes) {
+        return;
+    }
+
+    QList<int> ids;
+    ids.reserve(selected.size());
+    for (const QModelIndex &index : selected) {
+        int id = m_scoreModel->getScoreAt(index.row()).id;
+        if (id != -1) {
+            ids.append(id);
+        }
+    }
+
+    if (DatabaseManager::instance()->deleteScores(ids)) {
+        m_scoreModel->applyChanges();
+        clearForm();
+        refreshFilterCombos();
+        updateStatusBar(QString("已删除 %1 条成绩").arg(ids.size()));
+        ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->totalCount()));
+    } else {
+        QMessageBox::warning(this, "错误", "批量删除失败，所有记录均未删除");
+    }
+}
+
 void MainWindow::on_btnRefresh_clicked()
 {
+    // 清除排序标志，模型随之回到按考试日期降序分页读取
+    ui->tableView->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+    // 刷新清除班级、课程筛选；下拉框回到“所有”，不触发筛选
+    {
+        QSignalBlocker classBlocker(ui->comboFilterClass);
+        QSignalBlocker courseBlocker(ui->comboFilterCourse);
+        ui->comboFilterClass->setCurrentIndex(0);
+        ui->comboFilterCourse->setCurrentIndex(0);
+    }
     m_scoreModel->refreshData();
     refreshFilterCombos();
+    // 搜索框中还有关键字时按关键字重新筛选
+    if (!ui->editSearch->text().isEmpty())
+        startSearch();
     updateStatusBar("数据已刷新");
-    ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->rowCount()));
+    ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->totalCount()));
 }
 
 void MainWindow::on_btnImportCSV_clicked()
 {
-    QString filePath = QFileDialog::getOpenFileName(this, "选择CSV文件", "", "CSV文件 (*.csv);;所有文件 (*.*)");
+    QString filePath = QFileDialog::getOpenFileName(this, "选择CSV、Excel或快照文件", "",
+                                                    "数据文件 (*.csv *.xlsx *.sgss);;CSV文件 (*.csv);;Excel文件 (*.xlsx);;数据快照 (*.sgss);;所有文件 (*.*)");
     if (filePath.isEmpty()) return;
 
     // 确认导入
@@ -395,17 +628,14 @@ void MainWindow::on_btnImportCSV_clicked()
 
     if (reply != QMessageBox::Yes) return;
 
-    if (DatabaseManager::instance()->importFromCSV(filePath)) {
-        m_scoreModel->refreshData();
-        refreshFilterCombos();
-        updateStatusBar("CSV导入成功");
-        ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->rowCount()));
-
-        // 更新图表
-        setupCharts();
-    } else {
-        QMessageBox::warning(this, "错误", "CSV导入失败");
+    // 在后台执行，完成后在 finishBulkJob 中刷新界面
+    BulkJob::Type type = BulkJob::ImportCsv;
+    if (filePath.endsWith(".xlsx", Qt::CaseInsensitive)) {
+        type = BulkJob::ImportExcel;
+    } else if (filePath.endsWith(".sgss", Qt::CaseInsensitive)) {
+        type = BulkJob::ImportSnapshot;
     }
+    startBulkJob(type, filePath);
 }
 
 void MainWindow::on_btnExport_clicked()
@@ -417,21 +647,138 @@ void MainWindow::on_btnExport_clicked()
 
     QString defaultFileName = QString("学生成绩_%1.csv")
                                   .arg(QDate::currentDate().toString("yyyyMMdd"));
-    QString filePath = QFileDialog::getSaveFileName(this, "导出报表", defaultFileName, "CSV文件 (*.csv);;所有文件 (*.*)");
+    QString selectedFilter;
+    QString filePath = QFileDialog::getSaveFileName(this, "导出报表", defaultFileName,
+                                                    "CSV文件 (*.csv);;数据快照 (*.sgss);;所有文件 (*.*)",
+                                                    &selectedFilter);
     if (filePath.isEmpty()) return;
 
-    if (!filePath.endsWith(".csv", Qt::CaseInsensitive)) {
+    // 快照用于在机器之间搬运整张成绩表，导出的是全部数据而不是当前筛选结果
+    bool snapshot = filePath.endsWith(".sgss", Qt::CaseInsensitive) || selectedFilter.contains("*.sgss");
+    if (snapshot && !filePath.endsWith(".sgss", Qt::CaseInsensitive)) {
+        filePath += ".sgss";
+    } else if (!snapshot && !filePath.endsWith(".csv", Qt::CaseInsensitive)) {
         filePath += ".csv";
     }
 
-    if (DatabaseManager::instance()->exportToCSV(filePath)) {
-        updateStatusBar(QString("报表已导出到: %1").arg(filePath));
-        QMessageBox::information(this, "导出成功",
-                                 QString("成功导出 %1 条记录到:\n%2")
-                                     .arg(m_scoreModel->rowCount())
-                                     .arg(filePath));
+    startBulkJob(snapshot ? BulkJob::ExportSnapshot : BulkJob::ExportCsv, filePath);
+}
+
+void MainWindow::startBulkJob(BulkJob::Type type, const QString &filePath)
+{
+    if (m_bulkJob && m_bulkJob->isRunning()) {
+        QMessageBox::warning(this, "警告", "已有导入或导出任务正在进行");
+        return;
+    }
+
+    delete m_bulkJob;
+    m_bulkJob = new BulkJob(type, filePath, this);
+    connect(m_bulkJob, &BulkJob::progressChanged, this, &MainWindow::updateBulkJobProgress);
+    connect(m_bulkJob, &BulkJob::finished, this, &MainWindow::finishBulkJob);
+    // 导出当前表格中显示的数据（班级/课程/关键字筛选）
+    m_bulkJob->setFilter(ui->comboFilterClass->currentText(),
+                         ui->comboFilterCourse->currentText(),
+                         ui->editSearch->text());
+
+    setBulkJobRunning(true);
+    ui->statusbar->showMessage(m_bulkJob->isExport() ? "正在导出..." : "正在导入...");
+    m_bulkJob->start();
+}
+
+void MainWindow::setBulkJobRunning(bool running)
+{
+    // 任务运行期间禁止其他写操作，避免与后台事务争用数据库锁
+    ui->btnImportCSV->setEnabled(!running);
+    ui->btnExport->setEnabled(!running);
+    ui->btnAdd->setEnabled(!running);
+    ui->btnUpdate->setEnabled(!running);
+    ui->btnDelete->setEnabled(!running);
+    ui->actionImport->setEnabled(!running);
+    ui->actionExport->setEnabled(!running);
+
+    m_jobProgressBar->setValue(0);
+    m_jobProgressBar->setVisible(running);
+    m_btnCancelJob->setEnabled(running);
+    m_btnCancelJob->setVisible(running);
+}
+
+void MainWindow::updateBulkJobProgress(qint64 rowsDone, double rowsPerSecond, int etaSeconds, double fraction)
+{
+    if (!m_bulkJob) return;
+
+    m_jobProgressBar->setValue(int(fraction * 1000));
+
+    QString message = QString("%1: 已处理 %2 行, %3 行/秒")
+                          .arg(m_bulkJob->isExport() ? "正在导出" : "正在导入")
+                          .arg(rowsDone)
+                          .arg(qRound64(rowsPerSecond));
+    if (etaSeconds >= 0) {
+        message += QString(", 预计剩余 %1 秒").arg(etaSeconds);
+    }
+    ui->statusbar->showMessage(message);
+}
+
+void MainWindow::finishBulkJob(bool success, bool cancelled)
+{
+    setBulkJobRunning(false);
+    if (!m_bulkJob) return;
+
+    BulkJob::Type type = m_bulkJob->type();
+    bool isExport = m_bulkJob->isExport();
+    QString filePath = m_bulkJob->filePath();
+    qint64 rows = m_bulkJob->rowsDone();
+
+    if (cancelled) {
+        updateStatusBar(isExport ? "导出已取消" : "导入已取消，数据已回滚");
+        return;
+    }
+
+    if (!isExport) {
+        if (success) {
+            m_scoreModel->applyChanges();
+            refreshFilterCombos();
+            // 汇总各事务块的新增/更新/未变/失败行数
+            int inserted = 0, updated = 0, unchanged = 0, failed = 0;
+            for (const ImportChunkResult &chunk : DatabaseManager::instance()->lastImportReport()) {
+                inserted += chunk.insertedCount;
+                updated += chunk.updatedCount;
+                unchanged += chunk.unchangedCount;
+                failed += chunk.errorCount;
+            }
+            updateStatusBar(QString("导入成功：新增 %1 行，更新 %2 行，未变 %3 行，失败 %4 行")
+                                .arg(inserted).arg(updated).arg(unchanged).arg(failed));
+            ui->labelRecordCount->setText(QString("总记录数: %1").arg(m_scoreModel->totalCount()));
+
+            // 更新图表
+            setupCharts();
+        } else {
+            QString message = "CSV导入失败";
+            if (type == BulkJob::ImportExcel) {
+                message = "Excel导入失败";
+            } else if (type == BulkJob::ImportSnapshot) {
+                message = "快照导入失败，文件可能已损坏，数据已回滚";
+            }
+            QMessageBox::warning(this, "错误", message);
+        }
     } else {
-        QMessageBox::warning(this, "错误", "报表导出失败");
+        if (success) {
+            updateStatusBar(QString("报表已导出到: %1").arg(filePath));
+            QMessageBox::information(this, "导出成功",
+                                     QString("成功导出 %1 条记录到:\n%2")
+                                         .arg(rows)
+                                         .arg(filePath));
+        } else {
+            QMessageBox::warning(this, "错误", "报表导出失败");
+        }
+    }
+}
+
+void MainWindow::cancelBulkJob()
+{
+    if (m_bulkJob && m_bulkJob->isRunning()) {
+        m_btnCancelJob->setEnabled(false);
+        ui->statusbar->showMessage("正在取消...");
+        m_bulkJob->cancel();
     }
 }
 
@@ -442,14 +789,38 @@ void MainWindow::on_btnCalculateStats_clicked()
         return;
     }
 
-    QString className = ui->comboStatsClass->currentText();
-    QString course = ui->comboStatsCourse->currentText();
+    m_statsRequested = true;
+    requestStatistics();
+}
 
-    QMap<QString, QVariant> stats = DatabaseManager::instance()->calculateStatistics(
-        className == "所有班级" ? "" : className,
-        course == "所有课程" ? "" : course
-        );
+void MainWindow::requestStatistics()
+{
+    m_chartClass = ui->comboStatsClass->currentText();
+    m_chartCourse = ui->comboStatsCourse->currentText();
+    QString className = m_chartClass == "所有班级" ? "" : m_chartClass;
+    QString course = m_chartCourse == "所有课程" ? "" : m_chartCourse;
+
+    // 四个查询在查询线程池中并行执行，各自完成后分别更新标签和图表
+    DatabaseManager *manager = DatabaseManager::instance();
+    replaceFuture(m_statsWatcher, manager->calculateStatisticsAsync(className, course));
+    replaceFuture(m_distributionWatcher, manager->getScoreDistributionAsync(className, course, 5));  // 使用5个区间
+    replaceFuture(m_comparisonWatcher, manager->getCourseComparisonAsync(className));
+
+    if (course.isEmpty()) {
+        // 没有选择具体课程时不查询趋势，显示提示信息
+        m_trendWatcher.cancel();
+        QChart *emptyChart = new QChart();
+        emptyChart->setTitle("请选择具体课程查看成绩趋势");
+        ui->chartViewTrend->setChart(emptyChart);
+    } else {
+        replaceFuture(m_trendWatcher, manager->getCourseTrendDataAsync(className, course));
+    }
 
+    updateStatusBar("正在统计...");
+}
+
+void MainWindow::showStatistics(const QMap<QString, QVariant> &stats)
+{
     // 更新统计结果标签
     ui->labelAvgValue->setText(QString::number(stats["avg"].toDouble(), 'f', 2));
     ui->labelMaxValue->setText(QString::number(stats["max"].toDouble(), 'f', 2));
@@ -458,23 +829,17 @@ void MainWindow::on_btnCalculateStats_clicked()
     ui->labelPassRateValue->setText(QString::number(stats["pass_rate"].toDouble(), 'f', 2) + "%");
     ui->labelCountValue->setText(QString::number(stats["count"].toInt()));
 
-    // 更新图表
-    showHistogramChart(className, course);
-    showTrendChart(className, course);
-    showComparisonChart(className);
-
-    updateStatusBar("统计计算完成");
+    // 四分位数只在数据库连接支持时提供
+    auto quartile = [&stats](const char *key) {
+        return stats.contains(key) ? QString::number(stats[key].toDouble(), 'f', 2) : QString("-");
+    };
+    ui->labelQ1Value->setText(quartile("q1"));
+    ui->labelMedianValue->setText(quartile("median"));
+    ui->labelQ3Value->setText(quartile("q3"));
 }
 
-void MainWindow::showHistogramChart(const QString &className, const QString &course)
+void MainWindow::showHistogramChart(const QList<QMap<QString, QVariant>> &distribution)
 {
-    // 从数据库获取实际的成绩分布数据
-    QList<QMap<QString, QVariant>> distribution = DatabaseManager::instance()->getScoreDistribution(
-        className == "所有班级" ? "" : className,
-        course == "所有课程" ? "" : course,
-        5  // 使用5个区间
-        );
-
     if (distribution.isEmpty()) {
         // 如果没有数据，显示空图表
         QChart *emptyChart = new QChart();
@@ -485,7 +850,7 @@ void MainWindow::showHistogramChart(const QString &className, const QString &cou
 
     // 创建柱状图
     QChart *chart = new QChart();
-    chart->setTitle(QString("成绩分布 - %1 %2").arg(className).arg(course));
+    chart->setTitle(QString("成绩分布 - %1 %2").arg(m_chartClass).arg(m_chartCourse));
 
     QBarSeries *series = new QBarSeries();
     QBarSet *set = new QBarSet("人数分布");
@@ -536,23 +901,9 @@ void MainWindow::showHistogramChart(const QString &className, const QString &cou
     ui->chartViewHistogram->setChart(chart);
 }
 
-void MainWindow::showTrendChart(const QString &className, const QString &course)
+void MainWindow::showTrendChart(const QList<QMap<QString, QVariant>> &trendData)
 {
-    // 检查是否选择了课程
-    if (course == "所有课程" || course.isEmpty()) {
-        // 如果没有选择具体课程，显示提示信息
-        QChart *emptyChart = new QChart();
-        emptyChart->setTitle("请选择具体课程查看成绩趋势");
-        ui->chartViewTrend->setChart(emptyChart);
-        return;
-    }
-
-    // 从数据库获取课程平均成绩趋势数据
-    QList<QMap<QString, QVariant>> trendData = DatabaseManager::instance()->getCourseTrendData(
-        className == "所有班级" ? "" : className,
-        course
-        );
-
+    QString course = m_chartCourse;
     if (trendData.isEmpty()) {
         // 如果没有数据，显示空图表
         QChart *emptyChart = new QChart();
@@ -565,7 +916,7 @@ void MainWindow::showTrendChart(const QString &className, const QString &course)
 
     // 创建图表
     QChart *chart = new QChart();
-    chart->setTitle(QString("%1 成绩趋势 - %2").arg(course).arg(className));
+    chart->setTitle(QString("%1 成绩趋势 - %2").arg(course).arg(m_chartClass));
 
     // 创建折线系列
     QLineSeries *series = new QLineSeries();
@@ -651,13 +1002,8 @@ void MainWindow::showTrendChart(const QString &className, const QString &course)
     ui->chartViewTrend->setChart(chart);
 }
 
-void MainWindow::showComparisonChart(const QString &className)
+void MainWindow::showComparisonChart(const QList<QMap<QString, QVariant>> &comparisonData)
 {
-    // 从数据库获取实际课程对比数据
-    QList<QMap<QString, QVariant>> comparisonData = DatabaseManager::instance()->getCourseComparison(
-        className == "所有班级" ? "" : className
-        );
-
     if (comparisonData.isEmpty()) {
         // 如果没有数据，显示空图表
         QChart *emptyChart = new QChart();
@@ -667,7 +1013,7 @@ void MainWindow::showComparisonChart(const QString &className)
     }
 
     QChart *chart = new QChart();
-    chart->setTitle(QString("课程平均分对比 - %1").arg(className));
+    chart->setTitle(QString("课程平均分对比 - %1").arg(m_chartClass));
 
     // 使用柱状图显示课程对比
     QBarSeries *series = new QBarSeries();
@@ -737,7 +1083,6 @@ void MainWindow::clearForm()
     ui->editStudentName->clear();
     ui->spinScore->setValue(0);
     ui->dateExam->setDate(QDate::currentDate());
-    ui->tableView->clearSelection();
 }
 
 void MainWindow::refreshFilterCombos()
@@ -745,17 +1090,22 @@ void MainWindow::refreshFilterCombos()
     QStringList classes = DatabaseManager::instance()->getAllClasses();
     QStringList courses = DatabaseManager::instance()->getAllCourses();
 
-    ui->comboFilterClass->clear();
-    ui->comboFilterClass->addItems(classes);
-
-    ui->comboFilterCourse->clear();
-    ui->comboFilterCourse->addItems(courses);
-
-    ui->comboStatsClass->clear();
-    ui->comboStatsClass->addItems(classes);
-
-    ui->comboStatsCourse->clear();
-    ui->comboStatsCourse->addItems(courses);
+    // 每次编辑后都会调用，班级、课程都没有变化时不动下拉框，当前筛选条件和表格保持不变
+    if (classes != m_filterClasses || courses != m_filterCourses) {
+        m_filterClasses = classes;
+        m_filterCourses = courses;
+
+        // 重建期间不触发筛选和统计；只有原来选中的班级/课程已经不存在时才按新的选择重新查询
+        bool filterChanged = setComboItems(ui->comboFilterClass, classes);
+        filterChanged = setComboItems(ui->comboFilterCourse, courses) || filterChanged;
+        bool statsChanged = setComboItems(ui->comboStatsClass, classes);
+        statsChanged = setComboItems(ui->comboStatsCourse, courses) || statsChanged;
+
+        if (filterChanged)
+            startSearch();
+        if (statsChanged && m_statsRequested)
+            requestStatistics();
+    }
 
     // 如果班级下拉框为空，添加默认选项
     if (ui->comboClass->count() == 0) {
@@ -771,39 +1121,60 @@ void MainWindow::refreshFilterCombos()
 
 void MainWindow::on_editSearch_textChanged(const QString &text)
 {
+    Q_UNUSED(text);
+    // 每次按键都作废尚未返回的搜索，输入停顿后再按最终的关键字搜索一次
+    m_filterWatcher.cancel();
+    m_searchTimer.start();
+}
+
+void MainWindow::startSearch()
+{
+    m_searchTimer.stop();
     QString className = ui->comboFilterClass->currentText();
     QString course = ui->comboFilterCourse->currentText();
-
-    m_scoreModel->filterData(
-        className == "所有班级" ? "" : className,
-        course == "所有课程" ? "" : course,
-        text
-        );
-    ui->labelRecordCount->setText(QString("筛选记录数: %1").arg(m_scoreModel->rowCount()));
+    m_filterClass = className == "所有班级" ? "" : className;
+    m_filterCourse = course == "所有课程" ? "" : course;
+    m_filterKeyword = ui->editSearch->text();
+
+    // 在原有关键字后继续输入、且当前结果完整在内存中时只在当前结果中筛选；
+    // 否则查询数据库的第一页，其余的页在表格滚动时由模型读取。
+    // 结果返回前再次搜索时，旧的请求被新请求取代
+    m_filterInMemory = m_scoreModel->canNarrowTo(m_filterClass, m_filterCourse, m_filterKeyword);
+    if (m_filterInMemory) {
+        m_filterVersion = m_scoreModel->changeVersion();
+        replaceFuture(m_filterWatcher, m_scoreModel->narrowAsync(m_filterKeyword));
+    } else {
+        m_filterVersion = DatabaseManager::instance()->latestChangeVersion();
+        replaceFuture(m_filterWatcher, DatabaseManager::instance()->getScoresPageAsync(
+                                           m_filterClass, m_filterCourse, m_filterKeyword,
+                                           ScoreCursor(), ScoreModel::PageSize));
+    }
 }
 
 void MainWindow::on_comboFilterClass_currentTextChanged(const QString &text)
 {
     Q_UNUSED(text);
-    on_editSearch_textChanged(ui->editSearch->text());
+    startSearch();
 }
 
 void MainWindow::on_comboFilterCourse_currentTextChanged(const QString &text)
 {
     Q_UNUSED(text);
-    on_editSearch_textChanged(ui->editSearch->text());
+    startSearch();
 }
 
 void MainWindow::on_comboStatsClass_currentTextChanged(const QString &text)
 {
-    Q_UNUSED(text);
-    // 可以在这里添加动态更新统计图表的逻辑
+    // 已经统计过时随选择动态更新，连续切换时只有最后一次选择的结果会显示
+    if (m_statsRequested && !text.isEmpty())
+        requestStatistics();
 }
 
 void MainWindow::on_comboStatsCourse_currentTextChanged(const QString &text)
 {
-    Q_UNUSED(text);
-    // 可以在这里添加动态更新统计图表的逻辑
+    // 已经统计过时随选择动态更新，连续切换时只有最后一次选择的结果会显示
+    if (m_statsRequested && !text.isEmpty())
+        requestStatistics();
 }
 
 void MainWindow::updateStatusBar(const QString &message)
@@ -823,13 +1194,26 @@ void MainWindow::generateReport()
         return;
     }
 
-    QString className = ui->comboStatsClass->currentText();
-    QString course = ui->comboStatsCourse->currentText();
+    m_reportClass = ui->comboStatsClass->currentText();
+    m_reportCourse = ui->comboStatsCourse->currentText();
+    replaceFuture(m_reportWatcher, DatabaseManager::instance()->calculateStatisticsAsync(
+                                       m_reportClass == "所有班级" ? "" : m_reportClass,
+                                       m_reportCourse == "所有课程" ? "" : m_reportCourse));
+    updateStatusBar("正在生成报告...");
+}
 
-    QMap<QString, QVariant> stats = DatabaseManager::instance()->calculateStatistics(
-        className == "所有班级" ? "" : className,
-        course == "所有课程" ? "" : course
-        );
+void MainWindow::showReport(const QMap<QString, QVariant> &stats)
+{
+    QString className = m_reportClass;
+    QString course = m_reportCourse;
+
+    QString quartiles;
+    if (stats.contains("median")) {
+        quartiles = QString("四分位数: %1 / %2 / %3\n")
+                        .arg(QString::number(stats["q1"].toDouble(), 'f', 2))
+                        .arg(QString::number(stats["median"].toDouble(), 'f', 2))
+                        .arg(QString::number(stats["q3"].toDouble(), 'f', 2));
+    }
 
     QString report = QString(
                          "========== 学生成绩分析报告 ==========\n\n"
@@ -840,6 +1224,7 @@ void MainWindow::generateReport()
                          "最高分: %4\n"
                          "最低分: %5\n"
                          "标准差: %6\n"
+                         "%11"
                          "及格率: %7%%\n"
                          "学生人数: %8\n\n"
                          "生成时间: %9\n"
@@ -854,7 +1239,8 @@ void MainWindow::generateReport()
                          .arg(QString::number(stats["pass_rate"].toDouble(), 'f', 2))
                          .arg(QString::number(stats["count"].toInt()))
                          .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss"))
-                         .arg(DatabaseManager::instance()->getDatabasePath());
+                         .arg(DatabaseManager::instance()->getDatabasePath())
+                         .arg(quartiles);
 
     QMessageBox::information(this, "学生成绩分析报告", report);
 }
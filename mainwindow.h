@@ -3,7 +3,13 @@
 
 #include <QMainWindow>
 #include <QStandardItemModel>
+#include <QFutureWatcher>
+#include <QTimer>
 #include "scoremodel.h"
+#include "bulkjob.h"
+
+class QProgressBar;
+class QPushButton;
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -50,10 +56,43 @@ private slots:
     void on_actionReports_triggered();
     void on_actionAbout_triggered();
 
+    // 后台导入/导出任务
+    void updateBulkJobProgress(qint64 rowsDone, double rowsPerSecond, int etaSeconds, double fraction);
+    void finishBulkJob(bool success, bool cancelled);
+    void cancelBulkJob();
 
 private:
     Ui::MainWindow *ui;
     ScoreModel *m_scoreModel;
+    BulkJob *m_bulkJob;
+    QProgressBar *m_jobProgressBar;
+    QPushButton *m_btnCancelJob;
+
+    // 异步查询：每类结果一个观察器，新请求取代同一观察器上尚未返回的旧请求
+    QFutureWatcher<QList<StudentScore>> m_filterWatcher;
+    QFutureWatcher<QMap<QString, QVariant>> m_statsWatcher;
+    QFutureWatcher<QList<QMap<QString, QVariant>>> m_distributionWatcher;
+    QFutureWatcher<QList<QMap<QString, QVariant>>> m_trendWatcher;
+    QFutureWatcher<QList<QMap<QString, QVariant>>> m_comparisonWatcher;
+    QFutureWatcher<QMap<QString, QVariant>> m_reportWatcher;
+    // 图表标题使用的班级/课程（与正在等待或已显示的结果对应）
+    QString m_chartClass;
+    QString m_chartCourse;
+    QString m_reportClass;
+    QString m_reportCourse;
+    bool m_statsRequested;
+    // 正在等待的筛选请求的条件和发出时的变更日志版本；
+    // 请求读取数据库的第一页，或者在模型已有的行中筛选（m_filterInMemory）
+    QString m_filterClass;
+    QString m_filterCourse;
+    QString m_filterKeyword;
+    qint64 m_filterVersion;
+    bool m_filterInMemory;
+    // 搜索框输入停顿后才开始搜索
+    QTimer m_searchTimer;
+    // 筛选/统计下拉框当前的选项，没有变化时不重建
+    QStringList m_filterClasses;
+    QStringList m_filterCourses;
 
     void setupUI();
     void setupDatabase();
@@ -62,13 +101,22 @@ private:
     void loadSelectedScoreToForm();
     void clearForm();
     void updateStatusBar(const QString &message);
+    void startBulkJob(BulkJob::Type type, const QString &filePath);
+    void setBulkJobRunning(bool running);
+    void setupQueryWatchers();
+    void startSearch();
+    void updateSelectedScores(const QModelIndexList &selected);
+    void deleteSelectedScores(const QModelIndexList &selected);
+    void requestStatistics();
 
     void showDefaultCharts();
-    void showHistogramChart(const QString& className, const QString& course);
-    void showTrendChart(const QString& className, const QString& course);
-    void showComparisonChart(const QString& className);
+    void showStatistics(const QMap<QString, QVariant>& stats);
+    void showHistogramChart(const QList<QMap<QString, QVariant>>& distribution);
+    void showTrendChart(const QList<QMap<QString, QVariant>>& trendData);
+    void showComparisonChart(const QList<QMap<QString, QVariant>>& comparisonData);
 
     void generateReport();
+    void showReport(const QMap<QString, QVariant>& stats);
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,589 @@
+#include "schemamigrator.h"
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QStringList>
+
+namespace {
+
+// ---------- 版本1：维度表 + 整数键事实表，scores 为兼容视图 ----------
+// 版本0为旧版单表 scores（每行重复保存姓名、班级、课程文本）
+
+const char *const NormalizedSchema[] = {
+    "CREATE TABLE students ("
+    "id INTEGER PRIMARY KEY,"
+    "student_no TEXT NOT NULL UNIQUE,"
+    "name TEXT NOT NULL"
+    ")",
+    "CREATE TABLE classes ("
+    "id INTEGER PRIMARY KEY,"
+    "name TEXT NOT NULL UNIQUE"
+    ")",
+    "CREATE TABLE courses ("
+    "id INTEGER PRIMARY KEY,"
+    "name TEXT NOT NULL UNIQUE"
+    ")",
+    "CREATE TABLE score_facts ("
+    "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "student_key INTEGER NOT NULL REFERENCES students(id),"
+    "class_key INTEGER NOT NULL REFERENCES classes(id),"
+    "course_key INTEGER NOT NULL REFERENCES courses(id),"
+    "score REAL NOT NULL,"
+    "exam_date DATE NOT NULL,"
+    "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
+    ")",
+    // 自然键：同一学生同一课程同一考试日期只有一条成绩
+    "CREATE UNIQUE INDEX idx_fact_natural_key ON score_facts(student_key, course_key, exam_date)",
+    "CREATE INDEX idx_fact_class_course ON score_facts(class_key, course_key)",
+    "CREATE INDEX idx_fact_course_date ON score_facts(course_key, exam_date)",
+    "CREATE INDEX idx_fact_exam_date ON score_facts(exam_date)",
+    // 兼容视图：列名与旧版 scores 表相同，另外带出三个整数键供筛选使用
+    "CREATE VIEW scores AS SELECT "
+    "f.id AS id, s.student_no AS student_id, s.name AS student_name, "
+    "c.name AS class_name, co.name AS course, f.score AS score, "
+    "f.exam_date AS exam_date, f.created_at AS created_at, "
+    "f.student_key AS student_key, f.class_key AS class_key, f.course_key AS course_key "
+    "FROM score_facts f "
+    "JOIN students s ON s.id = f.student_key "
+    "JOIN classes c ON c.id = f.class_key "
+    "JOIN courses co ON co.id = f.course_key"
+};
+
+// 旧表中不能迁入事实表的行原样移到这里并注明原因，迁移后不删除，由用户决定如何处理
+const char *const LegacyRejectedTable =
+    "CREATE TABLE scores_legacy_rejected ("
+    "id INTEGER, student_id TEXT, student_name TEXT, class_name TEXT, course TEXT, "
+    "score REAL, exam_date DATE, created_at TIMESTAMP, "
+    "reason TEXT NOT NULL, rejected_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
+    ")";
+
+struct LegacyRejection {
+    const char *reason;
+    const char *condition;      // 作用于 scores_legacy 的 WHERE 条件
+};
+
+// 按顺序执行，前一条移走的行不再参与后一条的判断
+const LegacyRejection LegacyRejections[] = {
+    // 外部工具写入的旧库可能不满足新表的 NOT NULL 约束
+    {"缺少必填字段",
+     "student_id IS NULL OR student_name IS NULL OR class_name IS NULL OR course IS NULL "
+     "OR score IS NULL OR exam_date IS NULL"},
+    // 自然键唯一索引只允许每组一条，保留最新的（ID最大的）一条
+    {"自然键重复（同一学号、课程、考试日期已保留最新的一条）",
+     "id NOT IN (SELECT MAX(id) FROM scores_legacy GROUP BY student_id, course, exam_date)"}
+};
+
+// 从旧版单表迁移：同一学号取最新一行的姓名。
+// 不能迁入的行此前已移走，这里全部使用普通 INSERT，任何一行失败都使整个迁移回滚，旧表保持原样
+const char *const LegacyCopy[] = {
+    "INSERT INTO students (student_no, name) "
+    "SELECT student_id, student_name FROM scores_legacy "
+    "WHERE id IN (SELECT MAX(id) FROM scores_legacy GROUP BY student_id)",
+    "INSERT INTO classes (name) SELECT DISTINCT class_name FROM scores_legacy ORDER BY class_name",
+    "INSERT INTO courses (name) SELECT DISTINCT course FROM scores_legacy ORDER BY course",
+    "INSERT INTO score_facts (id, student_key, class_key, course_key, score, exam_date, created_at) "
+    "SELECT l.id, s.id, c.id, co.id, l.score, l.exam_date, l.created_at FROM scores_legacy l "
+    "JOIN students s ON s.student_no = l.student_id "
+    "JOIN classes c ON c.name = l.class_name "
+    "JOIN courses co ON co.name = l.course "
+    "ORDER BY l.id"
+};
+
+// 把旧表中满足条件的行移到 scores_legacy_rejected，返回移走的行数，失败时返回-1
+int rejectLegacyRows(SchemaMigrator::Context &context, const LegacyRejection &rejection)
+{
+    QString condition = QString::fromUtf8(rejection.condition);
+    context.query.prepare("INSERT INTO scores_legacy_rejected "
+                          "(id, student_id, student_name, class_name, course, score, exam_date, created_at, reason) "
+                          "SELECT id, student_id, student_name, class_name, course, score, exam_date, created_at, ? "
+                          "FROM scores_legacy WHERE " + condition);
+    context.query.addBindValue(QString::fromUtf8(rejection.reason));
+    if (!context.query.exec()) {
+        qDebug() << "迁移语句执行失败:" << context.query.lastError().text() << condition;
+        return -1;
+    }
+    int count = context.query.numRowsAffected();
+    if (count > 0 && !context.exec("DELETE FROM scores_legacy WHERE " + condition))
+        return -1;
+    return count;
+}
+
+bool rejectLegacyRows(SchemaMigrator::Context &context, int &total)
+{
+    if (!context.exec(LegacyRejectedTable))
+        return false;
+
+    total = 0;
+    QStringList details;
+    for (const LegacyRejection &rejection : LegacyRejections) {
+        int count = rejectLegacyRows(context, rejection);
+        if (count < 0)
+            return false;
+        if (count > 0)
+            details << QString("%1：%2 条").arg(QString::fromUtf8(rejection.reason)).arg(count);
+        total += count;
+    }
+
+    if (total == 0)
+        return context.exec("DROP TABLE scores_legacy_rejected");
+
+    qDebug() << "旧版成绩表中有" << total << "条记录未迁入，已保存到 scores_legacy_rejected:" << details;
+    context.notices << QString("升级数据库时有 %1 条旧成绩记录无法迁入新的表结构，"
+                               "已原样保存在数据库的 scores_legacy_rejected 表中（未删除）：\n%2")
+                           .arg(total).arg(details.join("\n"));
+    return true;
+}
+
+qint64 countRows(SchemaMigrator::Context &context, const char *table)
+{
+    if (!context.exec(QString("SELECT COUNT(*) FROM %1").arg(table)) || !context.query.next())
+        return -1;
+    qint64 count = context.query.value(0).toLongLong();
+    context.query.finish();
+    return count;
+}
+
+bool normalizeSchema(SchemaMigrator::Context &context)
+{
+    context.query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'scores'");
+    bool hasLegacyTable = context.query.next();
+    context.query.finish();
+
+    if (hasLegacyTable && !context.exec("ALTER TABLE scores RENAME TO scores_legacy"))
+        return false;
+    for (const char *sql : NormalizedSchema) {
+        if (!context.exec(sql))
+            return false;
+    }
+    if (hasLegacyTable) {
+        qint64 legacyCount = countRows(context, "scores_legacy");
+        int rejected = 0;
+        if (legacyCount < 0 || !rejectLegacyRows(context, rejected))
+            return false;
+        for (const char *sql : LegacyCopy) {
+            if (!context.exec(sql))
+                return false;
+        }
+
+        // 迁入的行加上移走的行必须等于旧表的全部行，否则不删除旧表
+        qint64 copied = countRows(context, "score_facts");
+        qDebug() << "旧版成绩表" << legacyCount << "条: 迁入" << copied << "条, 未迁入" << rejected << "条";
+        if (copied + rejected != legacyCount) {
+            qDebug() << "迁移前后行数不一致，放弃迁移";
+            return false;
+        }
+        if (!context.exec("DROP TABLE scores_legacy"))
+            return false;
+        // 旧表的页面全部成为空闲页
+        context.vacuum = true;
+    }
+    return true;
+}
+
+// ---------- 版本2：分析查询的覆盖索引 ----------
+// 统计/分布按 (班级, 课程) 过滤后只读成绩，趋势按 (课程, 日期) 分组后只读成绩，
+// 把 score 放进索引后这些查询不再回表；原来的两个索引是新索引的前缀，删除以减少写入开销
+bool addCoveringIndexes(SchemaMigrator::Context &context)
+{
+    return context.exec("CREATE INDEX idx_fact_class_course_score ON score_facts(class_key, course_key, score)")
+           && context.exec("CREATE INDEX idx_fact_course_date_score ON score_facts(course_key, exam_date, score)")
+           && context.exec("DROP INDEX IF EXISTS idx_fact_class_course")
+           && context.exec("DROP INDEX IF EXISTS idx_fact_course_date")
+           && context.exec("ANALYZE");
+}
+
+// ---------- 版本3：触发器维护的汇总表 ----------
+// score_summary 按 (班级, 课程)、score_daily_summary 按 (班级, 课程, 考试日期) 保存
+// 人数、总分、平方和、最高/最低分和及格人数，统计、课程对比和趋势直接读汇总行而不扫描成绩。
+// 删除或修改的恰好是最高/最低分时，从 score_facts 重新取该组的极值（走覆盖索引）；
+// 人数减到0的汇总行被删除
+
+struct SummaryTable {
+    const char *name;
+    QStringList keys;
+};
+
+QString summaryKeyCondition(const SummaryTable &table, const char *row)
+{
+    QStringList conditions;
+    for (const QString &key : table.keys)
+        conditions << QString("%1 = %2.%1").arg(key, row);
+    return conditions.join(" AND ");
+}
+
+// 把 row（new/old）的成绩计入汇总行
+QString summaryAdd(const SummaryTable &table, const char *row)
+{
+    QStringList values;
+    for (const QString &key : table.keys)
+        values << QString("%1.%2").arg(row, key);
+    return QString("INSERT INTO %1 (%2, count, total, total_squares, min_score, max_score, pass_count) "
+                   "VALUES (%3, 1, %4.score, %4.score * %4.score, %4.score, %4.score, %4.score >= 60) "
+                   "ON CONFLICT(%2) DO UPDATE SET count = count + 1, total = total + excluded.total, "
+                   "total_squares = total_squares + excluded.total_squares, "
+                   "min_score = MIN(min_score, excluded.min_score), "
+                   "max_score = MAX(max_score, excluded.max_score), "
+                   "pass_count = pass_count + excluded.pass_count; ")
+        .arg(table.name, table.keys.join(", "), values.join(", "), row);
+}
+
+// 从汇总行中扣除 row 的成绩，触发器在行已经删除/修改之后执行，重新取极值时不会再读到它
+QString summaryRemove(const SummaryTable &table, const char *row)
+{
+    QString condition = summaryKeyCondition(table, row);
+    return QString("UPDATE %1 SET count = count - 1, total = total - %2.score, "
+                   "total_squares = total_squares - %2.score * %2.score, "
+                   "pass_count = pass_count - (%2.score >= 60), "
+                   "min_score = CASE WHEN %2.score > min_score THEN min_score "
+                   "ELSE (SELECT MIN(score) FROM score_facts WHERE %3) END, "
+                   "max_score = CASE WHEN %2.score < max_score THEN max_score "
+                   "ELSE (SELECT MAX(score) FROM score_facts WHERE %3) END "
+                   "WHERE %3; "
+                   "DELETE FROM %1 WHERE %3 AND count = 0; ")
+        .arg(table.name, row, condition);
+}
+
+const SummaryTable SummaryTables[] = {
+    {"score_summary", {"class_key", "course_key"}},
+    {"score_daily_summary", {"class_key", "course_key", "exam_date"}}
+};
+
+// 修改：先按旧值扣除再按新值计入（班级、课程或日期改变时分属两个汇总行）
+QString summaryUpdateTrigger()
+{
+    QString body;
+    for (const SummaryTable &table : SummaryTables)
+        body += summaryRemove(table, "old");
+    for (const SummaryTable &table : SummaryTables)
+        body += summaryAdd(table, "new");
+    return "CREATE TRIGGER trg_summary_update AFTER UPDATE OF class_key, course_key, exam_date, score "
+           "ON score_facts BEGIN " + body + "END";
+}
+
+bool addSummaryTables(SchemaMigrator::Context &context)
+{
+    QString insertBody, deleteBody;
+    for (const SummaryTable &table : SummaryTables) {
+        QStringList columns;
+        for (const QString &key : table.keys)
+            columns << key + (key == "exam_date" ? " DATE NOT NULL" : " INTEGER NOT NULL");
+        // 极值可为NULL：组内最后一行被删除时先得到NULL，随后整行删除
+        QString create = QString("CREATE TABLE %1 (%2, "
+                                 "count INTEGER NOT NULL, total REAL NOT NULL, total_squares REAL NOT NULL, "
+                                 "min_score REAL, max_score REAL, pass_count INTEGER NOT NULL, "
+                                 "PRIMARY KEY (%3)) WITHOUT ROWID")
+                             .arg(table.name, columns.join(", "), table.keys.join(", "));
+        // 用现有成绩初始化
+        QString fill = QString("INSERT INTO %1 (%2, count, total, total_squares, min_score, max_score, pass_count) "
+                               "SELECT %2, COUNT(*), SUM(score), SUM(score * score), MIN(score), MAX(score), "
+                               "SUM(score >= 60) FROM score_facts GROUP BY %2")
+                           .arg(table.name, table.keys.join(", "));
+        if (!context.exec(create) || !context.exec(fill))
+            return false;
+
+        insertBody += summaryAdd(table, "new");
+        deleteBody += summaryRemove(table, "old");
+    }
+
+    return context.exec("CREATE TRIGGER trg_summary_insert AFTER INSERT ON score_facts BEGIN " + insertBody + "END")
+           && context.exec("CREATE TRIGGER trg_summary_delete AFTER DELETE ON score_facts BEGIN " + deleteBody + "END")
+           && context.exec(summaryUpdateTrigger());
+}
+
+// ---------- 版本4：学号/姓名子串搜索索引 ----------
+// 学生维度表上的 FTS5 trigram 外部内容索引，任意位置的3个及以上字符（含中文）的子串查找走索引；
+// 由触发器与 students 表保持同步。SQLite 未编译 FTS5 或版本低于 3.34（没有 trigram 分词器）时
+// 不建索引，搜索退回到在学生维度表上 LIKE；之后 SQLite 升级时由 ensureSearchIndex() 补建
+
+// supported 返回 SQLite 是否支持 FTS5 trigram，不支持时不算失败
+bool buildStudentSearchIndex(SchemaMigrator::Context &context, bool &supported)
+{
+    supported = context.query.exec("CREATE VIRTUAL TABLE student_search USING fts5("
+                                   "student_no, name, content='students', content_rowid='id', tokenize='trigram')");
+    if (!supported) {
+        qDebug() << "SQLite 不支持 FTS5 trigram，不建立搜索索引:" << context.query.lastError().text();
+        return true;
+    }
+    return context.exec("INSERT INTO student_search (student_search) VALUES ('rebuild')")
+           && context.exec("CREATE TRIGGER trg_student_search_insert AFTER INSERT ON students BEGIN "
+                           "INSERT INTO student_search (rowid, student_no, name) "
+                           "VALUES (new.id, new.student_no, new.name); END")
+           && context.exec("CREATE TRIGGER trg_student_search_delete AFTER DELETE ON students BEGIN "
+                           "INSERT INTO student_search (student_search, rowid, student_no, name) "
+                           "VALUES ('delete', old.id, old.student_no, old.name); END")
+           && context.exec("CREATE TRIGGER trg_student_search_update AFTER UPDATE ON students BEGIN "
+                           "INSERT INTO student_search (student_search, rowid, student_no, name) "
+                           "VALUES ('delete', old.id, old.student_no, old.name); "
+                           "INSERT INTO student_search (rowid, student_no, name) "
+                           "VALUES (new.id, new.student_no, new.name); END");
+}
+
+bool addStudentSearchIndex(SchemaMigrator::Context &context)
+{
+    bool supported = false;
+    return buildStudentSearchIndex(context, supported);
+}
+
+// ---------- 版本5：分页查询的排序索引 ----------
+// 表格按 (exam_date DESC, id DESC) 键集分页；普通索引末尾隐含 rowid(id)，
+// 以 exam_date 结尾的索引即按分页顺序排列。无筛选时使用 idx_fact_exam_date，
+// 只按课程筛选时使用 (course_key, exam_date, score)，同一日期内再排序
+bool addPagingIndexes(SchemaMigrator::Context &context)
+{
+    return context.exec("CREATE INDEX idx_fact_class_date ON score_facts(class_key, exam_date)")
+           && context.exec("CREATE INDEX idx_fact_class_course_date ON score_facts(class_key, course_key, exam_date)")
+           && context.exec("ANALYZE");
+}
+
+// ---------- 版本6：考试日期改为儒略日整数 ----------
+// exam_date 原为 'yyyy-MM-dd' 文本，改为与 QDate::toJulianDay() 相同的整数日序号：
+// 读取时 QDate::fromJulianDay() 直接构造，不再逐行按格式解析，日期比较和排序也变成整数比较。
+// 换算期间先去掉汇总表的修改触发器（日期整体换算不改变任何分组），汇总表的日期键一并换算
+bool encodeExamDates(SchemaMigrator::Context &context)
+{
+    return context.exec("DROP TRIGGER trg_summary_update")
+           && context.exec("UPDATE score_facts SET exam_date = CAST(julianday(exam_date) + 0.5 AS INTEGER) "
+                           "WHERE typeof(exam_date) = 'text'")
+           && context.exec("UPDATE score_daily_summary SET exam_date = CAST(julianday(exam_date) + 0.5 AS INTEGER) "
+                           "WHERE typeof(exam_date) = 'text'")
+           && context.exec(summaryUpdateTrigger())
+           && context.exec("ANALYZE");
+}
+
+// ---------- 版本7：成绩变更日志 ----------
+// score_changes 按递增的版本号记录 score_facts 每一行的插入、修改和删除（1/2/3，同 ScoreChange::Operation），
+// 表格模型据此只更新变化的行而不整表重新读取。AUTOINCREMENT 保证日志被清理后版本号也不会重用。
+// 学生改名时该学生的全部成绩行都计为修改（表格中显示姓名）
+bool addChangeLog(SchemaMigrator::Context &context)
+{
+    return context.exec("CREATE TABLE score_changes ("
+                        "version INTEGER PRIMARY KEY AUTOINCREMENT,"
+                        "score_id INTEGER NOT NULL,"
+                        "operation INTEGER NOT NULL"
+                        ")")
+           && context.exec("CREATE TRIGGER trg_changes_insert AFTER INSERT ON score_facts BEGIN "
+                           "INSERT INTO score_changes (score_id, operation) VALUES (new.id, 1); END")
+           && context.exec("CREATE TRIGGER trg_changes_update AFTER UPDATE ON score_facts BEGIN "
+                           "INSERT INTO score_changes (score_id, operation) VALUES (new.id, 2); END")
+           && context.exec("CREATE TRIGGER trg_changes_delete AFTER DELETE ON score_facts BEGIN "
+                           "INSERT INTO score_changes (score_id, operation) VALUES (old.id, 3); END")
+           && context.exec("CREATE TRIGGER trg_changes_student_name AFTER UPDATE OF name ON students BEGIN "
+                           "INSERT INTO score_changes (score_id, operation) "
+                           "SELECT id, 2 FROM score_facts WHERE student_key = new.id; END");
+}
+
+// ---------- 版本8：变更日志记录时间 ----------
+// 同一数据库文件可能被多个客户端同时打开（共享盘），日志是大家共用的：
+// 不能按“自己已应用到的版本”清理，改为只清理记录时间早于保留期限的日志（见 DatabaseManager::pruneChanges）。
+// 已有的日志记为时间0，下次清理时删除
+bool addChangeTimestamps(SchemaMigrator::Context &context)
+{
+    const char *now = "CAST(strftime('%s', 'now') AS INTEGER)";
+    return context.exec("ALTER TABLE score_changes ADD COLUMN changed_at INTEGER NOT NULL DEFAULT 0")
+           && context.exec("CREATE INDEX idx_changes_time ON score_changes(changed_at)")
+           && context.exec("DROP TRIGGER trg_changes_insert")
+           && context.exec("DROP TRIGGER trg_changes_update")
+           && context.exec("DROP TRIGGER trg_changes_delete")
+           && context.exec("DROP TRIGGER trg_changes_student_name")
+           && context.exec(QString("CREATE TRIGGER trg_changes_insert AFTER INSERT ON score_facts BEGIN "
+                                   "INSERT INTO score_changes (score_id, operation, changed_at) "
+                                   "VALUES (new.id, 1, %1); END").arg(now))
+           && context.exec(QString("CREATE TRIGGER trg_changes_update AFTER UPDATE ON score_facts BEGIN "
+                                   "INSERT INTO score_changes (score_id, operation, changed_at) "
+                                   "VALUES (new.id, 2, %1); END").arg(now))
+           && context.exec(QString("CREATE TRIGGER trg_changes_delete AFTER DELETE ON score_facts BEGIN "
+                                   "INSERT INTO score_changes (score_id, operation, changed_at) "
+                                   "VALUES (old.id, 3, %1); END").arg(now))
+           && context.exec(QString("CREATE TRIGGER trg_changes_student_name AFTER UPDATE OF name ON students BEGIN "
+                                   "INSERT INTO score_changes (score_id, operation, changed_at) "
+                                   "SELECT id, 2, %1 FROM score_facts WHERE student_key = new.id; END").arg(now));
+}
+
+// 按版本号递增排列，只能在末尾追加
+const SchemaMigrator::Migration Migrations[] = {
+    {1, "维度表与整数键事实表", normalizeSchema},
+    {2, "分析查询覆盖索引", addCoveringIndexes},
+    {3, "触发器维护的统计汇总表", addSummaryTables},
+    {4, "学号/姓名子串搜索索引", addStudentSearchIndex},
+    {5, "分页查询排序索引", addPagingIndexes},
+    {6, "考试日期改为儒略日整数", encodeExamDates},
+    {7, "成绩变更日志", addChangeLog},
+    {8, "变更日志记录时间", addChangeTimestamps}
+};
+
+} // namespace
+
+bool SchemaMigrator::Context::exec(const QString &sql)
+{
+    if (query.exec(sql))
+        return true;
+    qDebug() << "迁移语句执行失败:" << query.lastError().text() << sql;
+    return false;
+}
+
+SchemaMigrator::SchemaMigrator(QSqlDatabase database)
+    : m_database(database)
+{
+}
+
+int SchemaMigrator::latestVersion()
+{
+    return Migrations[sizeof(Migrations) / sizeof(Migrations[0]) - 1].version;
+}
+
+int SchemaMigrator::currentVersion()
+{
+    QSqlQuery query(m_database);
+    if (!query.exec("PRAGMA user_version") || !query.next())
+        return -1;
+    return query.value(0).toInt();
+}
+
+QString SchemaMigrator::lastError() const
+{
+    return m_lastError;
+}
+
+QStringList SchemaMigrator::notices() const
+{
+    return m_notices;
+}
+
+bool SchemaMigrator::migrate()
+{
+    int version = currentVersion();
+    if (version < 0) {
+        m_lastError = "无法读取数据库结构版本";
+        return false;
+    }
+    if (version > latestVersion()) {
+        m_lastError = QString("数据库结构版本 %1 高于程序支持的版本 %2").arg(version).arg(latestVersion());
+        qDebug() << m_lastError;
+        return false;
+    }
+    if (version == latestVersion())
+        return true;
+
+    if (!ensureHistoryTable())
+        return false;
+
+    bool vacuum = false;
+    for (const Migration &migration : Migrations) {
+        if (migration.version <= version)
+            continue;
+        if (!runMigration(migration, vacuum))
+            return false;
+    }
+
+    if (vacuum) {
+        QElapsedTimer timer;
+        timer.start();
+        QSqlQuery query(m_database);
+        query.exec("VACUUM");
+        qDebug() << "迁移后收缩数据库文件，耗时" << timer.elapsed() << "ms";
+    }
+    return true;
+}
+
+bool SchemaMigrator::ensureSearchIndex()
+{
+    QSqlQuery query(m_database);
+    if (query.exec("SELECT 1 FROM sqlite_master WHERE name = 'student_search'") && query.next())
+        return true;
+    query.finish();
+    // 版本4之前的数据库由迁移建立索引
+    if (currentVersion() < 4)
+        return false;
+
+    if (!m_database.transaction()) {
+        m_lastError = m_database.lastError().text();
+        return false;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    bool supported = false;
+    bool success = false;
+    {
+        Context context{query, false, QStringList()};
+        success = buildStudentSearchIndex(context, supported) && supported;
+        if (supported && !success)
+            m_lastError = query.lastError().text();
+        query.finish();
+    }
+
+    if (success && m_database.commit()) {
+        qDebug() << "补建学号/姓名搜索索引，耗时" << timer.elapsed() << "ms";
+        return true;
+    }
+    m_database.rollback();
+    if (supported)
+        qDebug() << "补建搜索索引失败，已回滚:" << m_lastError;
+    return false;
+}
+
+bool SchemaMigrator::ensureHistoryTable()
+{
+    QSqlQuery query(m_database);
+    if (!query.exec("CREATE TABLE IF NOT EXISTS schema_migrations ("
+                    "version INTEGER PRIMARY KEY,"
+                    "description TEXT NOT NULL,"
+                    "duration_ms INTEGER NOT NULL,"
+                    "applied_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
+                    ")")) {
+        m_lastError = query.lastError().text();
+        qDebug() << "创建迁移记录表失败:" << m_lastError;
+        return false;
+    }
+    return true;
+}
+
+bool SchemaMigrator::runMigration(const Migration &migration, bool &vacuum)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!m_database.transaction()) {
+        m_lastError = m_database.lastError().text();
+        qDebug() << "开始迁移事务失败:" << m_lastError;
+        return false;
+    }
+
+    bool success = false;
+    QStringList notices;
+    {
+        QSqlQuery query(m_database);
+        Context context{query, false, QStringList()};
+        success = migration.apply(context);
+
+        // 版本号和迁移记录与迁移本身在同一个事务中提交
+        success = success && context.exec(QString("PRAGMA user_version = %1").arg(migration.version));
+        if (success) {
+            query.prepare("INSERT OR REPLACE INTO schema_migrations (version, description, duration_ms) "
+                          "VALUES (?, ?, ?)");
+            query.addBindValue(migration.version);
+            query.addBindValue(QString::fromUtf8(migration.description));
+            query.addBindValue(timer.elapsed());
+            success = query.exec();
+        }
+        if (!success)
+            m_lastError = query.lastError().text();
+        query.finish();
+        vacuum = vacuum || (success && context.vacuum);
+        notices = context.notices;
+    }
+
+    if (success && !m_database.commit()) {
+        m_lastError = m_database.lastError().text();
+        success = false;
+    }
+    if (!success) {
+        m_database.rollback();
+        qDebug() << "数据库迁移失败，已回滚: 版本" << migration.version << migration.description << m_lastError;
+        return false;
+    }
+
+    m_notices << notices;
+    qDebug() << "数据库迁移完成: 版本" << migration.version << migration.description
+             << "，耗时" << timer.elapsed() << "ms";
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+
+// 数据库结构迁移：PRAGMA user_version 记录当前版本，
+// 启动时按版本号顺序执行尚未执行过的迁移。
+// 每个迁移在独立的事务中执行，成功后在同一事务中写入新版本号，失败则整体回滚，
+// 数据库停留在上一个版本；执行结果和耗时记录到 schema_migrations 表和调试输出。
+// 新增迁移只需在 schemamigrator.cpp 的迁移列表末尾追加，已发布的迁移不能修改
+class SchemaMigrator
+{
+public:
+    // 迁移函数可用的上下文
+    struct Context {
+        QSqlQuery &query;
+        bool vacuum;    // 迁移释放了大量页面，全部完成后执行VACUUM收缩文件
+        QStringList notices;    // 需要告知用户的情况（例如有旧数据未能迁入），迁移提交后才生效
+
+        bool exec(const QString &sql);
+    };
+
+    struct Migration {
+        int version;
+        const char *description;
+        bool (*apply)(Context &context);
+    };
+
+    explicit SchemaMigrator(QSqlDatabase database);
+
+    // 升级到最新版本；数据库版本高于程序支持的版本时返回false
+    bool migrate();
+
+    int currentVersion();
+    static int latestVersion();
+
+    // 不占用版本号的可选结构：学号/姓名搜索索引需要 SQLite 支持 FTS5 trigram，
+    // 版本4迁移时不支持则跳过，之后每次启动时检查，SQLite 升级后在这里补建。
+    // 索引存在（或补建成功）时返回true
+    bool ensureSearchIndex();
+
+    QString lastError() const;
+    // 本次 migrate() 中已提交的迁移产生的提示
+    QStringList notices() const;
+
+private:
+    bool runMigration(const Migration &migration, bool &vacuum);
+    bool ensureHistoryTable();
+
+    QSqlDatabase m_database;
+    QString m_lastError;
+    QStringList m_notices;
+};
+
+#endif // SCHEMAMIGRATOR_H
@@ -0,0 +1,210 @@
+#include "scoreaggregates.h"
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QVariant>
+#include <QDebug>
+
+#ifdef SGS_SYSTEM_SQLITE
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// 驱动对象上的动态属性，标记该连接已注册聚合函数
+const char *InstalledProperty = "sgs_score_aggregates";
+
+// ---------- variance / stddev：Welford 在线算法 ----------
+
+struct Moments {
+    sqlite3_int64 count;
+    double mean;
+    double m2;      // 与均值之差的平方和
+};
+
+void momentsStep(sqlite3_context *context, int, sqlite3_value **argv)
+{
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL)
+        return;
+    Moments *moments = static_cast<Moments *>(sqlite3_aggregate_context(context, sizeof(Moments)));
+    if (!moments) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+    double x = sqlite3_value_double(argv[0]);
+    ++moments->count;
+    double delta = x - moments->mean;
+    moments->mean += delta / moments->count;
+    moments->m2 += delta * (x - moments->mean);
+}
+
+void varianceFinal(sqlite3_context *context)
+{
+    // 传入0不分配内存：没有输入行时返回NULL
+    Moments *moments = static_cast<Moments *>(sqlite3_aggregate_context(context, 0));
+    if (!moments || moments->count == 0) {
+        sqlite3_result_null(context);
+        return;
+    }
+    sqlite3_result_double(context, moments->m2 / moments->count);
+}
+
+void stddevFinal(sqlite3_context *context)
+{
+    Moments *moments = static_cast<Moments *>(sqlite3_aggregate_context(context, 0));
+    if (!moments || moments->count == 0) {
+        sqlite3_result_null(context);
+        return;
+    }
+    sqlite3_result_double(context, std::sqrt(moments->m2 / moments->count));
+}
+
+// ---------- median / percentile：收集全部值后选择第k小 ----------
+
+struct ValueList {
+    std::vector<double> *values;    // 聚合上下文只保存指针，最终函数中释放
+    double percent;
+};
+
+bool appendValue(sqlite3_context *context, sqlite3_value *value, double percent)
+{
+    ValueList *list = static_cast<ValueList *>(sqlite3_aggregate_context(context, sizeof(ValueList)));
+    if (!list) {
+        sqlite3_result_error_nomem(context);
+        return false;
+    }
+    if (!list->values) {
+        list->values = new std::vector<double>();
+        list->percent = percent;
+    }
+    if (sqlite3_value_type(value) != SQLITE_NULL)
+        list->values->push_back(sqlite3_value_double(value));
+    return true;
+}
+
+void medianStep(sqlite3_context *context, int, sqlite3_value **argv)
+{
+    appendValue(context, argv[0], 50.0);
+}
+
+void percentileStep(sqlite3_context *context, int, sqlite3_value **argv)
+{
+    double percent = sqlite3_value_double(argv[1]);
+    if (sqlite3_value_type(argv[1]) == SQLITE_NULL || percent < 0.0 || percent > 100.0) {
+        sqlite3_result_error(context, "percentile() 的第二个参数必须在 0~100 之间", -1);
+        return;
+    }
+    appendValue(context, argv[0], percent);
+}
+
+// 第 p 百分位：位置 p/100*(n-1)，落在两个值之间时线性插值
+double selectPercentile(std::vector<double> &values, double percent)
+{
+    double position = percent / 100.0 * (values.size() - 1);
+    size_t lower = size_t(position);
+    double fraction = position - lower;
+
+    std::nth_element(values.begin(), values.begin() + lower, values.end());
+    double value = values[lower];
+    if (fraction > 0.0 && lower + 1 < values.size()) {
+        // nth_element 之后 lower 右侧都不小于它，其中最小的就是第 lower+1 小
+        double upper = *std::min_element(values.begin() + lower + 1, values.end());
+        value += fraction * (upper - value);
+    }
+    return value;
+}
+
+void percentileFinal(sqlite3_context *context)
+{
+    ValueList *list = static_cast<ValueList *>(sqlite3_aggregate_context(context, 0));
+    if (!list || !list->values) {
+        sqlite3_result_null(context);
+        return;
+    }
+    if (list->values->empty())
+        sqlite3_result_null(context);
+    else
+        sqlite3_result_double(context, selectPercentile(*list->values, list->percent));
+    delete list->values;
+    list->values = nullptr;
+}
+
+struct Aggregate {
+    const char *name;
+    int argumentCount;
+    void (*step)(sqlite3_context *, int, sqlite3_value **);
+    void (*final)(sqlite3_context *);
+};
+
+const Aggregate Aggregates[] = {
+    {"variance", 1, momentsStep, varianceFinal},
+    {"stddev", 1, momentsStep, stddevFinal},
+    {"median", 1, medianStep, percentileFinal},
+    {"percentile", 2, percentileStep, percentileFinal}
+};
+
+// 驱动使用的 SQLite 与本程序链接的是否为同一个库：Qt 安装包通常自带 SQLite，
+// 那时驱动句柄属于另一个库，不能交给这里的 C API。
+// 版本号和源码标识都相同才认为是同一个库
+bool sameLibrary(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    if (!query.exec("SELECT sqlite_version(), sqlite_source_id()") || !query.next())
+        return false;
+    QString driverVersion = query.value(0).toString();
+    QString driverSource = query.value(1).toString();
+    if (driverVersion != QLatin1String(sqlite3_libversion()) || driverSource != QLatin1String(sqlite3_sourceid())) {
+        qDebug() << "Qt 的 SQLite 驱动" << driverVersion << "与程序链接的 sqlite3" << sqlite3_libversion()
+                 << "不是同一个库，不注册统计聚合函数";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool ScoreAggregates::install(QSqlDatabase database)
+{
+    QSqlDriver *driver = database.driver();
+    if (!driver || !database.isOpen())
+        return false;
+
+    QVariant handle = driver->handle();
+    if (!handle.isValid() || qstrcmp(handle.typeName(), "sqlite3*") != 0) {
+        qDebug() << "无法注册统计聚合函数：连接不是SQLite";
+        return false;
+    }
+    sqlite3 *connection = *static_cast<sqlite3 *const *>(handle.data());
+    if (!connection || !sameLibrary(database))
+        return false;
+
+    for (const Aggregate &aggregate : Aggregates) {
+        int rc = sqlite3_create_function_v2(connection, aggregate.name, aggregate.argumentCount,
+                                            SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr,
+                                            nullptr, aggregate.step, aggregate.final, nullptr);
+        if (rc != SQLITE_OK) {
+            qDebug() << "注册聚合函数失败:" << aggregate.name << sqlite3_errmsg(connection);
+            return false;
+        }
+    }
+    driver->setProperty(InstalledProperty, true);
+    return true;
+}
+
+#else
+
+bool ScoreAggregates::install(QSqlDatabase)
+{
+    // 未启用 system_sqlite 构建选项：驱动的 SQLite 与程序无关，不注册
+    return false;
+}
+
+#endif // SGS_SYSTEM_SQLITE
+
+bool ScoreAggregates::isInstalled(QSqlDatabase database)
+{
+    QSqlDriver *driver = database.driver();
+    return driver && driver->property(InstalledProperty).toBool();
+}
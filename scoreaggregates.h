@@ -0,0 +1,25 @@
+#ifndef SCOREAGGREGATES_H
+#define SCOREAGGREGATES_H
+
+#include <QSqlDatabase>
+
+// 通过 SQLite C API 在连接上注册的聚合函数，一次扫描即可得到全部统计量：
+//   variance(x)       总体方差（Welford 算法，数值稳定）
+//   stddev(x)         总体标准差
+//   median(x)         精确中位数
+//   percentile(x, p)  精确百分位数，p 为 0~100，相邻两个值之间线性插值
+// 均忽略 NULL，没有输入行时返回 NULL。
+// 需要 Qt 的 SQLite 驱动与程序链接的是同一个 sqlite3 库（Qt 使用 -system-sqlite 构建），
+// 因此只在 qmake CONFIG+=system_sqlite 时编译，且运行时确认两边的 SQLite 版本和源码标识一致才注册；
+// 其余情况下 install() 返回false，统计改用不依赖这些函数的查询
+class ScoreAggregates
+{
+public:
+    // 在已打开的连接上注册，未启用、驱动不是同一个 SQLite 或拿不到句柄时返回false
+    static bool install(QSqlDatabase database);
+
+    // 当前连接上是否已注册（注册失败时调用方应退回到不依赖这些函数的查询）
+    static bool isInstalled(QSqlDatabase database);
+};
+
+#endif // SCOREAGGREGATES_H
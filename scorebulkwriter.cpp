@@ -0,0 +1,326 @@
+#include "scorebulkwriter.h"
+#include <QSqlError>
+#include <QDebug>
+
+ScoreBulkWriter::ScoreBulkWriter(QSqlDatabase database, int batchSize, ImportMode mode)
+    : m_database(database)
+    , m_dimensionStatements(database)
+    , m_dimensions(m_dimensionStatements)
+    , m_insertQuery(database)
+    , m_updateQuery(database)
+    , m_savepointQuery(database)
+    , m_mode(mode)
+    , m_batchSize(batchSize > 0 ? batchSize : DefaultBatchSize)
+    , m_valid(false)
+    , m_atomic(false)
+    , m_inOuterTransaction(false)
+    , m_inChunk(false)
+    , m_successCount(0)
+    , m_insertedCount(0)
+    , m_updatedCount(0)
+    , m_unchangedCount(0)
+    , m_errorCount(0)
+{
+    // 只预编译一次，之后每行只重新绑定参数
+    if (m_mode == ImportMode::Upsert) {
+        m_valid = m_insertQuery.prepare(
+            "INSERT OR IGNORE INTO score_facts (student_key, class_key, course_key, score, exam_date) "
+            "VALUES (?, ?, ?, ?, ?)"
+            );
+        // 只有内容确实变化时才更新，完全相同的行受影响行数为0（姓名变化由维度表承担）
+        m_valid = m_valid && m_updateQuery.prepare(
+            "UPDATE score_facts SET class_key = ?, score = ? "
+            "WHERE student_key = ? AND course_key = ? AND exam_date = ? "
+            "AND NOT (class_key = ? AND score = ?)"
+            );
+    } else {
+        m_valid = m_insertQuery.prepare(
+            "INSERT INTO score_facts (student_key, class_key, course_key, score, exam_date) "
+            "VALUES (?, ?, ?, ?, ?)"
+            );
+    }
+    if (!m_valid) {
+        m_lastError = m_insertQuery.lastError().text() + m_updateQuery.lastError().text();
+        qDebug() << "批量写入预编译错误:" << m_lastError;
+    }
+}
+
+ScoreBulkWriter::~ScoreBulkWriter()
+{
+    // 未调用finish()时丢弃未提交的数据，保证不会留下半个事务块
+    if (m_inChunk || m_inOuterTransaction) {
+        rollbackAll();
+    }
+}
+
+bool ScoreBulkWriter::isValid() const
+{
+    return m_valid;
+}
+
+QString ScoreBulkWriter::lastError() const
+{
+    return m_lastError;
+}
+
+void ScoreBulkWriter::setAtomic(bool atomic)
+{
+    if (!m_inChunk && !m_inOuterTransaction)
+        m_atomic = atomic;
+}
+
+bool ScoreBulkWriter::append(const StudentScore &score)
+{
+    if (!m_valid)
+        return false;
+
+    if (!m_inChunk && !beginChunk())
+        return false;
+
+    m_current.rowCount++;
+    bool success = writeRow(score);
+    if (success) {
+        m_current.successCount++;
+    } else {
+        m_current.errorCount++;
+    }
+
+    if (m_current.rowCount >= m_batchSize) {
+        commitChunk();
+    }
+
+    return success;
+}
+
+bool ScoreBulkWriter::writeRow(const StudentScore &score)
+{
+    DimensionResolver::Keys keys;
+    if (!m_dimensions.resolve(score, keys)) {
+        m_lastError = m_dimensions.lastError();
+        return false;
+    }
+
+    const qint64 examDay = score.examDate.toJulianDay();
+
+    if (m_mode == ImportMode::Upsert) {
+        m_updateQuery.bindValue(0, keys.className);
+        m_updateQuery.bindValue(1, score.score);
+        m_updateQuery.bindValue(2, keys.student);
+        m_updateQuery.bindValue(3, keys.course);
+        m_updateQuery.bindValue(4, examDay);
+        m_updateQuery.bindValue(5, keys.className);
+        m_updateQuery.bindValue(6, score.score);
+        if (!m_updateQuery.exec()) {
+            m_lastError = m_updateQuery.lastError().text();
+            return false;
+        }
+        if (m_updateQuery.numRowsAffected() > 0) {
+            m_current.updatedCount++;
+            return true;
+        }
+    }
+
+    m_insertQuery.bindValue(0, keys.student);
+    m_insertQuery.bindValue(1, keys.className);
+    m_insertQuery.bindValue(2, keys.course);
+    m_insertQuery.bindValue(3, score.score);
+    m_insertQuery.bindValue(4, examDay);
+    if (!m_insertQuery.exec()) {
+        m_lastError = m_insertQuery.lastError().text();
+        return false;
+    }
+
+    // Upsert模式下被忽略的插入说明该行已存在且内容相同
+    if (m_insertQuery.numRowsAffected() > 0) {
+        m_current.insertedCount++;
+    } else {
+        m_current.unchangedCount++;
+    }
+    return true;
+}
+
+void ScoreBulkWriter::appendError()
+{
+    if (!m_inChunk && !beginChunk()) {
+        m_errorCount++;
+        return;
+    }
+
+    m_current.rowCount++;
+    m_current.errorCount++;
+
+    if (m_current.rowCount >= m_batchSize) {
+        commitChunk();
+    }
+}
+
+bool ScoreBulkWriter::finish()
+{
+    if (m_inChunk && !commitChunk() && !m_atomic)
+        return false;
+
+    if (m_inOuterTransaction) {
+        m_inOuterTransaction = false;
+        if (!m_database.commit()) {
+            QString error = m_database.lastError().text();
+            m_database.rollback();
+            discardCommitted(error);
+            return false;
+        }
+    }
+    return true;
+}
+
+void ScoreBulkWriter::rollbackAll()
+{
+    if (m_inChunk) {
+        m_inChunk = false;
+        m_insertQuery.finish();
+        m_updateQuery.finish();
+        if (!m_atomic)
+            m_database.rollback();
+        m_dimensions.clear();
+        clearWritten(m_current);
+        m_current.error = "已取消";
+        m_errorCount += m_current.errorCount;
+        m_results.append(m_current);
+    }
+
+    if (m_inOuterTransaction) {
+        m_inOuterTransaction = false;
+        m_database.rollback();
+        discardCommitted("已取消");
+    }
+}
+
+int ScoreBulkWriter::successCount() const
+{
+    return m_successCount;
+}
+
+int ScoreBulkWriter::insertedCount() const
+{
+    return m_insertedCount;
+}
+
+int ScoreBulkWriter::updatedCount() const
+{
+    return m_updatedCount;
+}
+
+int ScoreBulkWriter::unchangedCount() const
+{
+    return m_unchangedCount;
+}
+
+int ScoreBulkWriter::errorCount() const
+{
+    return m_errorCount;
+}
+
+QList<ImportChunkResult> ScoreBulkWriter::chunkResults() const
+{
+    return m_results;
+}
+
+bool ScoreBulkWriter::beginChunk()
+{
+    if (m_atomic) {
+        if (!m_inOuterTransaction) {
+            if (!m_database.transaction()) {
+                m_lastError = m_database.lastError().text();
+                qDebug() << "开始事务失败:" << m_lastError;
+                return false;
+            }
+            m_inOuterTransaction = true;
+        }
+        if (!m_savepointQuery.exec("SAVEPOINT import_chunk")) {
+            m_lastError = m_savepointQuery.lastError().text();
+            qDebug() << "创建保存点失败:" << m_lastError;
+            return false;
+        }
+    } else if (!m_database.transaction()) {
+        m_lastError = m_database.lastError().text();
+        qDebug() << "开始事务失败:" << m_lastError;
+        return false;
+    }
+
+    m_inChunk = true;
+    m_current = ImportChunkResult();
+    m_current.chunkIndex = m_results.size();
+    return true;
+}
+
+bool ScoreBulkWriter::commitChunk()
+{
+    m_inChunk = false;
+    m_insertQuery.finish();
+    m_updateQuery.finish();
+
+    bool committed = m_atomic ? m_savepointQuery.exec("RELEASE import_chunk")
+                              : m_database.commit();
+    if (committed) {
+        m_current.committed = true;
+    } else {
+        // 提交失败时整块回滚，本块内已成功的行全部计为失败
+        m_current.error = m_atomic ? m_savepointQuery.lastError().text()
+                                   : m_database.lastError().text();
+        m_lastError = m_current.error;
+        if (m_atomic) {
+            m_savepointQuery.exec("ROLLBACK TO import_chunk");
+            m_savepointQuery.exec("RELEASE import_chunk");
+        } else {
+            m_database.rollback();
+        }
+        // 本块新插入的维度行已随之回滚，缓存中的键不再有效
+        m_dimensions.clear();
+        m_current.committed = false;
+        clearWritten(m_current);
+    }
+
+    if (!m_current.committed || m_current.errorCount > 0) {
+        qDebug() << "导入事务块" << m_current.chunkIndex
+                 << (m_current.committed ? "已提交" : "已回滚")
+                 << ": 成功 =" << m_current.successCount
+                 << ", 失败 =" << m_current.errorCount
+                 << m_current.error;
+    }
+
+    m_successCount += m_current.successCount;
+    m_insertedCount += m_current.insertedCount;
+    m_updatedCount += m_current.updatedCount;
+    m_unchangedCount += m_current.unchangedCount;
+    m_errorCount += m_current.errorCount;
+    m_results.append(m_current);
+    return m_current.committed;
+}
+
+void ScoreBulkWriter::discardCommitted(const QString &error)
+{
+    m_dimensions.clear();
+
+    // 外层事务被回滚，之前释放的事务块全部作废
+    for (ImportChunkResult &chunk : m_results) {
+        if (chunk.committed) {
+            chunk.committed = false;
+            clearWritten(chunk);
+            chunk.error = error;
+        }
+    }
+    m_errorCount += m_successCount;
+    m_successCount = 0;
+    m_insertedCount = 0;
+    m_updatedCount = 0;
+    m_unchangedCount = 0;
+    m_lastError = error;
+}
+
+void ScoreBulkWriter::clearWritten(ImportChunkResult &chunk)
+{
+    // 事务块被回滚后，其中写入成功的行全部计为失败
+    chunk.errorCount += chunk.successCount;
+    chunk.successCount = 0;
+    chunk.insertedCount = 0;
+    chunk.updatedCount = 0;
+    chunk.unchangedCount = 0;
+}
@@ -0,0 +1,81 @@
+#ifndef SCOREBULKWRITER_H
+#define SCOREBULKWRITER_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QList>
+#include "databasemanager.h"
+#include "statementcache.h"
+#include "dimensionresolver.h"
+
+// 批量写入器：整个导入过程复用同一条预编译的INSERT语句，
+// 每 batchSize 行作为一个事务块提交，避免逐行自动提交带来的fsync开销
+// 原子模式下整个导入处于一个外层事务中，事务块改用SAVEPOINT，可随时整体回滚
+// Upsert模式下每行先按自然键尝试更新有变化的成绩，未命中再 INSERT OR IGNORE，
+// 两条语句都只预编译一次，用受影响行数区分新增、更新和未变
+// 学生、班级、课程先经 DimensionResolver 换成整数键，再写入事实表 score_facts
+class ScoreBulkWriter
+{
+public:
+    static const int DefaultBatchSize = 5000;
+
+    ScoreBulkWriter(QSqlDatabase database, int batchSize = DefaultBatchSize,
+                    ImportMode mode = ImportMode::Append);
+    ~ScoreBulkWriter();
+
+    bool isValid() const;
+    QString lastError() const;
+
+    // 须在第一次写入前设置
+    void setAtomic(bool atomic);
+
+    // 写入一行，当前事务块满时自动提交
+    bool append(const StudentScore& score);
+    // 记录一行在解析阶段就已失败的数据，计入当前事务块的失败数
+    void appendError();
+    // 提交最后一个未满的事务块（原子模式下同时提交外层事务）
+    bool finish();
+    // 放弃写入：原子模式下回滚整个导入，否则只回滚当前未提交的事务块
+    void rollbackAll();
+
+    int successCount() const;
+    int insertedCount() const;
+    int updatedCount() const;
+    int unchangedCount() const;
+    int errorCount() const;
+    QList<ImportChunkResult> chunkResults() const;
+
+private:
+    ScoreBulkWriter(const ScoreBulkWriter&) = delete;
+    ScoreBulkWriter& operator=(const ScoreBulkWriter&) = delete;
+
+    bool writeRow(const StudentScore &score);
+    bool beginChunk();
+    bool commitChunk();
+    void discardCommitted(const QString &error);
+    static void clearWritten(ImportChunkResult &chunk);
+
+    QSqlDatabase m_database;
+    StatementCache m_dimensionStatements;
+    DimensionResolver m_dimensions;
+    QSqlQuery m_insertQuery;
+    QSqlQuery m_updateQuery;
+    QSqlQuery m_savepointQuery;
+    ImportMode m_mode;
+    int m_batchSize;
+    bool m_valid;
+    bool m_atomic;
+    bool m_inOuterTransaction;
+    bool m_inChunk;
+    QString m_lastError;
+
+    ImportChunkResult m_current;
+    QList<ImportChunkResult> m_results;
+    int m_successCount;
+    int m_insertedCount;
+    int m_updatedCount;
+    int m_unchangedCount;
+    int m_errorCount;
+};
+
+#endif // SCOREBULKWRITER_H
@@ -1,18 +1,47 @@
 #include "scoremodel.h"
 #include <QBrush>
 #include <QColor>
+#include <QSet>
+#include <QThreadPool>
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+// 按 (考试日期, ID) 降序，cursor 是否排在 score 之前
+bool precedes(const ScoreCursor &cursor, const StudentScore &score)
+{
+    return cursor.examDate > score.examDate || (cursor.examDate == score.examDate && cursor.id > score.id);
+}
+
+bool scoreBefore(const StudentScore &a, const StudentScore &b)
+{
+    return precedes(ScoreCursor::after(a), b);
+}
+
+} // namespace
 
 ScoreModel::ScoreModel(QObject *parent)
     : QAbstractTableModel(parent)
+    , m_headers(QStringList() << "ID" << "学号" << "姓名" << "班级" << "课程" << "成绩" << "考试日期")
+    , m_hasMore(false)
+    , m_rowCount(0)
+    , m_totalCount(0)
+    , m_version(-1)
+    , m_sorter(m_headers.size())
+    , m_sortColumn(-1)
+    , m_sortOrder(Qt::AscendingOrder)
+    , m_sortVersion(-1)
 {
-    m_headers << "ID" << "学号" << "姓名" << "班级" << "课程" << "成绩" << "考试日期";
+    connect(&m_sortWatcher, &QFutureWatcher<QList<StudentScore>>::finished, this, &ScoreModel::finishSortLoad);
     refreshData();
 }
 
 int ScoreModel::rowCount(const QModelIndex &parent) const
 {
-    Q_UNUSED(parent);
-    return m_scores.size();
+    if (parent.isValid())
+        return 0;
+    return m_rowCount;
 }
 
 int ScoreModel::columnCount(const QModelIndex &parent) const
@@ -26,10 +55,13 @@ QVariant ScoreModel::data(const QModelIndex &index, int role) const
     if (!index.isValid())
         return QVariant();
 
-    if (index.row() >= m_scores.size() || index.row() < 0)
+    if (index.row() >= m_rowCount || index.row() < 0)
         return QVariant();
 
-    const StudentScore& score = m_scores.at(index.row());
+    const StudentScore *row = scoreAt(index.row());
+    if (!row)
+        return QVariant();
+    const StudentScore& score = *row;
 
     if (role == Qt::DisplayRole) {
         switch (index.column()) {
@@ -77,24 +109,518 @@ QVariant ScoreModel::headerData(int section, Qt::Orientation orientation, int ro
     return QVariant();
 }
 
-void ScoreModel::refreshData()
+bool ScoreModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !isSorted() && m_hasMore;
+}
+
+void ScoreModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || isSorted() || !m_hasMore)
+        return;
+
+    QList<StudentScore> rows = DatabaseManager::instance()->getScoresPage(m_className, m_course, m_keyword,
+                                                                          m_frontier, PageSize);
+    if (rows.isEmpty()) {
+        m_hasMore = false;
+        return;
+    }
+    beginInsertRows(QModelIndex(), m_rowCount, m_rowCount + rows.size() - 1);
+    appendPage(rows);
+    endInsertRows();
+}
+
+void ScoreModel::sort(int column, Qt::SortOrder order)
+{
+    if (column < 0 || column >= columnCount()) {
+        cancelSortLoad();
+        if (isSorted()) {
+            m_sorter.clear();
+            reload();
+        }
+        return;
+    }
+    if (!isSorted()) {
+        // 第一次排序才读入全部行（在后台进行），之后只在内存中重新排序
+        loadSorted(column, order);
+        return;
+    }
+    resort(column, order, QList<ScoreChange>());
+}
+
+bool ScoreModel::isSorted() const
+{
+    return m_sorter.column() >= 0;
+}
+
+bool ScoreModel::isSortLoading() const
+{
+    return m_sortColumn >= 0;
+}
+
+int ScoreModel::sortColumn() const
+{
+    return isSorted() ? m_sorter.column() : m_sortColumn;
+}
+
+Qt::SortOrder ScoreModel::sortOrder() const
+{
+    return isSorted() ? m_sorter.order() : m_sortOrder;
+}
+
+void ScoreModel::loadSorted(int column, Qt::SortOrder order)
 {
+    bool loading = isSortLoading();
+    m_sortColumn = column;
+    m_sortOrder = order;
+    if (loading)
+        return;
+
+    // 先取版本号再读数据，读完后补上期间的变更；读取期间仍显示分页读取的行
+    DatabaseManager *db = DatabaseManager::instance();
+    m_sortVersion = db->latestChangeVersion();
+    m_sortWatcher.setFuture(db->getScoresByFilterAsync(m_className, m_course, m_keyword));
+    emit sortLoadStarted();
+}
+
+void ScoreModel::finishSortLoad()
+{
+    // 读取已被取消或取代时，过期的完成通知不处理
+    if (!isSortLoading() || !m_sortWatcher.isFinished() || m_sortWatcher.isCanceled()
+        || m_sortWatcher.future().resultCount() == 0)
+        return;
+
+    int column = m_sortColumn;
+    m_sortColumn = -1;
     beginResetModel();
-    m_scores = DatabaseManager::instance()->getAllScores();
+    m_pages.clear();
+    m_recentPages.clear();
+    m_hasMore = false;
+    m_sorter.setScores(m_sortWatcher.result());
+    m_sorter.sort(column, m_sortOrder);
+    m_rowCount = m_sorter.size();
+    m_version = m_sortVersion;
     endResetModel();
+    m_totalCount = m_rowCount;
+
+    // 读取期间的变更还留在日志中
+    applyChanges();
+    emit sortLoadFinished();
+}
+
+void ScoreModel::cancelSortLoad()
+{
+    if (!isSortLoading())
+        return;
+    m_sortColumn = -1;
+    m_sortWatcher.cancel();
+}
+
+void ScoreModel::resort(int column, Qt::SortOrder order, const QList<ScoreChange> &changes)
+{
+    bool resize = false;
+    for (const ScoreChange &change : changes) {
+        bool keep = change.operation != ScoreChange::Delete && matchesFilter(change.score);
+        if (keep != m_sorter.contains(change.score.id)) {
+            resize = true;
+            break;
+        }
+    }
+    auto apply = [this, column, order, &changes]() {
+        for (const ScoreChange &change : changes) {
+            if (change.operation != ScoreChange::Delete && matchesFilter(change.score))
+                m_sorter.update(change.score);
+            else
+                m_sorter.remove(change.score.id);
+        }
+        m_sorter.sort(column, order);
+        m_rowCount = m_sorter.size();
+    };
+
+    // 增删了行时无法逐个对应，整体重置
+    if (resize) {
+        beginResetModel();
+        apply();
+        endResetModel();
+        return;
+    }
+
+    emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+    const QModelIndexList before = persistentIndexList();
+    QVector<int> ids;
+    ids.reserve(before.size());
+    for (const QModelIndex &index : before)
+        ids.append(m_sorter.at(index.row()).id);
+
+    apply();
+
+    QHash<int, int> rowOfId;
+    if (!ids.isEmpty()) {
+        QSet<int> wanted(ids.cbegin(), ids.cend());
+        for (int row = 0; row < m_sorter.size() && rowOfId.size() < wanted.size(); ++row) {
+            int id = m_sorter.at(row).id;
+            if (wanted.contains(id))
+                rowOfId.insert(id, row);
+        }
+    }
+    QModelIndexList after;
+    after.reserve(before.size());
+    for (int i = 0; i < before.size(); ++i)
+        after.append(index(rowOfId.value(ids.at(i)), before.at(i).column()));
+    changePersistentIndexList(before, after);
+    emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
+
+void ScoreModel::refreshData()
+{
+    m_className.clear();
+    m_course.clear();
+    m_keyword.clear();
+    reload();
 }
 
 void ScoreModel::filterData(const QString &className, const QString &course, const QString &keyword)
 {
+    m_className = className;
+    m_course = course;
+    m_keyword = keyword;
+    reload();
+}
+
+void ScoreModel::setFirstPage(const QString &className, const QString &course, const QString &keyword,
+                              const QList<StudentScore> &rows, qint64 version)
+{
+    // 查询期间的变更在下次 applyChanges 时补上（日志已过期清理时那时再整体重新读取）。
+    // 排序模式下先显示第一页，新条件下的全部行在后台读取
+    int column = sortColumn();
+    Qt::SortOrder order = sortOrder();
+    resetPages(className, course, keyword, rows, version);
+    m_totalCount = DatabaseManager::instance()->countScores(className, course, keyword);
+    if (column >= 0)
+        loadSorted(column, order);
+}
+
+void ScoreModel::reload()
+{
+    DatabaseManager *db = DatabaseManager::instance();
+    // 先取版本号再读数据：期间发生的变更下次会再应用一次，按行的当前内容覆盖，结果相同
+    qint64 version = db->latestChangeVersion();
+    // 排序模式下同样只同步读取第一页，全部行在后台读取，读完后按原来的列排序
+    int column = sortColumn();
+    Qt::SortOrder order = sortOrder();
+    QList<StudentScore> rows = db->getScoresPage(m_className, m_course, m_keyword, ScoreCursor(), PageSize);
+    resetPages(m_className, m_course, m_keyword, rows, version);
+    m_totalCount = db->countScores(m_className, m_course, m_keyword);
+    db->pruneChanges();
+    if (column >= 0)
+        loadSorted(column, order);
+}
+
+void ScoreModel::resetPages(const QString &className, const QString &course, const QString &keyword,
+                            const QList<StudentScore> &firstPage, qint64 version)
+{
+    // 回到分页模式，正在进行的排序读取针对的是原来的条件
+    cancelSortLoad();
     beginResetModel();
-    m_scores = DatabaseManager::instance()->getScoresByFilter(className, course, keyword);
+    m_className = className;
+    m_course = course;
+    m_keyword = keyword;
+    m_sorter.clear();
+    m_pages.clear();
+    m_recentPages.clear();
+    m_frontier = ScoreCursor();
+    m_rowCount = 0;
+    // 结果为空时也保留第一页，之后新增的行插入其中
+    appendPage(firstPage);
+    m_version = version;
     endResetModel();
 }
 
+void ScoreModel::appendPage(const QList<StudentScore> &rows)
+{
+    Page page;
+    page.after = m_frontier;
+    page.firstRow = m_rowCount;
+    page.rowCount = rows.size();
+    page.loaded = true;
+    page.rows = rows;
+    m_pages.append(page);
+    touchPage(m_pages.size() - 1);
+
+    m_rowCount += rows.size();
+    if (!rows.isEmpty())
+        m_frontier = ScoreCursor::after(rows.last());
+    m_hasMore = rows.size() == PageSize;
+}
+
+const ScoreModel::Page &ScoreModel::loadedPage(int page) const
+{
+    Page &entry = m_pages[page];
+    if (!entry.loaded) {
+        entry.rows = DatabaseManager::instance()->getScoresPage(m_className, m_course, m_keyword,
+                                                                entry.after, entry.rowCount);
+        entry.loaded = true;
+    }
+    touchPage(page);
+    return entry;
+}
+
+void ScoreModel::touchPage(int page) const
+{
+    if (!m_recentPages.isEmpty() && m_recentPages.last() == page)
+        return;
+    m_recentPages.removeOne(page);
+    m_recentPages.append(page);
+    if (m_recentPages.size() > MaxCachedPages) {
+        Page &evicted = m_pages[m_recentPages.takeFirst()];
+        evicted.rows.clear();
+        evicted.loaded = false;
+    }
+}
+
+int ScoreModel::pageOfRow(int row) const
+{
+    // 最后一个 firstRow <= row 的页（其前面 firstRow 相同的页都已被删空）
+    auto it = std::upper_bound(m_pages.cbegin(), m_pages.cend(), row,
+                               [](int value, const Page &page) { return value < page.firstRow; });
+    return int(it - m_pages.cbegin()) - 1;
+}
+
+int ScoreModel::pageOfKey(const StudentScore &score) const
+{
+    if (m_pages.isEmpty())
+        return -1;
+    if (m_hasMore && precedes(m_frontier, score))
+        return -1;
+    // 最后一个起始游标排在 score 之前的页，第一页的游标无效，视为排在所有行之前
+    auto it = std::partition_point(m_pages.cbegin() + 1, m_pages.cend(),
+                                   [&score](const Page &page) { return precedes(page.after, score); });
+    return int(it - m_pages.cbegin()) - 1;
+}
+
+bool ScoreModel::locate(int id, int &page, int &offset) const
+{
+    for (int loaded : m_recentPages) {
+        const QList<StudentScore> &rows = m_pages.at(loaded).rows;
+        for (int i = 0; i < rows.size(); ++i) {
+            if (rows.at(i).id == id) {
+                page = loaded;
+                offset = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ScoreModel::matchesFilter(const StudentScore &score) const
+{
+    // 与 DatabaseManager::filterClause 相同的条件
+    if (!m_className.isEmpty() && m_className != "所有班级" && score.className != m_className)
+        return false;
+    if (!m_course.isEmpty() && m_course != "所有课程" && score.course != m_course)
+        return false;
+    return matchesKeyword(score, m_keyword);
+}
+
+bool ScoreModel::matchesKeyword(const StudentScore &score, const QString &keyword)
+{
+    return keyword.isEmpty()
+           || score.studentId.contains(keyword, Qt::CaseInsensitive)
+           || score.studentName.contains(keyword, Qt::CaseInsensitive);
+}
+
+bool ScoreModel::canNarrowTo(const QString &className, const QString &course, const QString &keyword) const
+{
+    if (className != m_className || course != m_course || !keyword.contains(m_keyword, Qt::CaseInsensitive))
+        return false;
+    // 排序模式下全部行都在内存中；分页模式要求已经读到末尾且没有页被换出
+    return isSorted() || (!m_hasMore && m_recentPages.size() == m_pages.size());
+}
+
+QFuture<QList<StudentScore>> ScoreModel::narrowAsync(const QString &keyword) const
+{
+    // 各页和排序模式下的全部行都是隐式共享的，交给后台线程不复制数据
+    QList<QList<StudentScore>> parts;
+    if (isSorted()) {
+        parts.append(m_sorter.scores());
+    } else {
+        for (const Page &page : m_pages)
+            parts.append(page.rows);
+    }
+
+    auto promise = std::make_shared<QFutureInterface<QList<StudentScore>>>();
+    promise->reportStarted();
+    QFuture<QList<StudentScore>> future = promise->future();
+    QThreadPool::globalInstance()->start([promise, parts, keyword]() {
+        QList<StudentScore> rows;
+        int checked = 0;
+        for (const QList<StudentScore> &part : parts) {
+            for (const StudentScore &score : part) {
+                // 每检查一批行看一次是否已被新的输入取代
+                if (checked++ % 4096 == 0 && promise->isCanceled()) {
+                    promise->reportFinished();
+                    return;
+                }
+                if (matchesKeyword(score, keyword))
+                    rows.append(score);
+            }
+        }
+        promise->reportResult(rows);
+        promise->reportFinished();
+    });
+    return future;
+}
+
+void ScoreModel::setNarrowedRows(const QString &className, const QString &course, const QString &keyword,
+                                 const QList<StudentScore> &rows, qint64 version)
+{
+    if (version != m_version) {
+        filterData(className, course, keyword);
+        return;
+    }
+    int column = sortColumn();
+    if (column >= 0) {
+        // 结果是完整的，还在等待排序读取时也直接在内存中排序
+        Qt::SortOrder order = sortOrder();
+        cancelSortLoad();
+        beginResetModel();
+        m_className = className;
+        m_course = course;
+        m_keyword = keyword;
+        m_pages.clear();
+        m_recentPages.clear();
+        m_hasMore = false;
+        m_sorter.clear();
+        m_sorter.setScores(rows);
+        m_sorter.sort(column, order);
+        m_rowCount = m_sorter.size();
+        endResetModel();
+    } else {
+        // 结果是完整的，放在一页中，不再向数据库读取后续的页
+        resetPages(className, course, keyword, rows, version);
+        m_hasMore = false;
+    }
+    m_totalCount = rows.size();
+}
+
+void ScoreModel::updateFirstRows()
+{
+    int firstRow = 0;
+    for (Page &page : m_pages) {
+        page.firstRow = firstRow;
+        firstRow += page.rowCount;
+    }
+    m_rowCount = firstRow;
+}
+
+void ScoreModel::applyChanges()
+{
+    DatabaseManager *db = DatabaseManager::instance();
+    qint64 version = db->latestChangeVersion();
+    if (version == m_version)
+        return;
+
+    QList<ScoreChange> changes;
+    if (m_version < 0 || !db->getChangesSince(m_version, version, MaxIncrementalChanges, changes)) {
+        reload();
+        return;
+    }
+    if (isSorted()) {
+        resort(m_sorter.column(), m_sorter.order(), changes);
+    } else {
+        for (const ScoreChange &change : changes) {
+            if (!applyChange(change)) {
+                reload();
+                return;
+            }
+        }
+    }
+    m_version = version;
+    m_totalCount = db->countScores(m_className, m_course, m_keyword);
+    db->pruneChanges();
+}
+
+bool ScoreModel::applyChange(const ScoreChange &change)
+{
+    const StudentScore &score = change.score;
+    bool allLoaded = m_recentPages.size() == m_pages.size();
+    int page = -1, offset = -1;
+    bool found = locate(score.id, page, offset);
+    int target = change.operation != ScoreChange::Delete && matchesFilter(score) ? pageOfKey(score) : -1;
+
+    // 修改或删除的行不在内存中时，可能在已换出的页里
+    if (!found && change.operation != ScoreChange::Insert && !allLoaded)
+        return false;
+    // 新位置所在的页已换出时，重新读取会读到已经包含本次变更的数据
+    if (target >= 0 && !m_pages.at(target).loaded)
+        return false;
+
+    if (!found) {
+        if (target < 0)
+            return true;
+        Page &to = m_pages[target];
+        int position = int(std::lower_bound(to.rows.cbegin(), to.rows.cend(), score, scoreBefore) - to.rows.cbegin());
+        int row = to.firstRow + position;
+        beginInsertRows(QModelIndex(), row, row);
+        to.rows.insert(position, score);
+        ++to.rowCount;
+        updateFirstRows();
+        endInsertRows();
+        return true;
+    }
+
+    Page &from = m_pages[page];
+    int source = from.firstRow + offset;
+    if (target < 0) {
+        beginRemoveRows(QModelIndex(), source, source);
+        from.rows.removeAt(offset);
+        --from.rowCount;
+        updateFirstRows();
+        endRemoveRows();
+        return true;
+    }
+
+    // 考试日期改变时行要移到新位置；用移动而不是删除再插入，视图中的选中状态跟着行走。
+    // 行号不变但跨过页边界时也要换到目标页，否则两页重新读取时会重复或遗漏这一行
+    Page &to = m_pages[target];
+    int position = int(std::lower_bound(to.rows.cbegin(), to.rows.cend(), score, scoreBefore) - to.rows.cbegin());
+    int destination = to.firstRow + position;
+    bool moves = destination != source && destination != source + 1;
+    if (moves)
+        beginMoveRows(QModelIndex(), source, source, QModelIndex(), destination);
+    from.rows.removeAt(offset);
+    --from.rowCount;
+    if (target == page && position > offset)
+        --position;
+    to.rows.insert(position, score);
+    ++to.rowCount;
+    updateFirstRows();
+    if (moves)
+        endMoveRows();
+
+    int row = to.firstRow + position;
+    emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+    return true;
+}
+
+const StudentScore *ScoreModel::scoreAt(int row) const
+{
+    if (row < 0 || row >= m_rowCount)
+        return nullptr;
+    if (isSorted())
+        return &m_sorter.at(row);
+
+    const Page &page = loadedPage(pageOfRow(row));
+    int offset = row - page.firstRow;
+    return offset < page.rows.size() ? &page.rows.at(offset) : nullptr;
+}
+
 StudentScore ScoreModel::getScoreAt(int row) const
 {
-    if (row >= 0 && row < m_scores.size())
-        return m_scores.at(row);
+    const StudentScore *score = scoreAt(row);
+    if (score)
+        return *score;
 
     // 返回一个空结构体
     static StudentScore emptyScore;
@@ -102,3 +628,13 @@ StudentScore ScoreModel::getScoreAt(int row) const
     emptyScore.score = 0.0;
     return emptyScore;
 }
+
+qint64 ScoreModel::totalCount() const
+{
+    return m_totalCount;
+}
+
+qint64 ScoreModel::changeVersion() const
+{
+    return m_version;
+}
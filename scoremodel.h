@@ -2,14 +2,26 @@
 #define SCOREMODEL_H
 
 #include <QAbstractTableModel>
+#include <QFutureWatcher>
 #include <QList>
+#include <QVector>
 #include "databasemanager.h"
+#include "scoresorter.h"
 
+// 成绩表格模型：按 (考试日期, ID) 降序分页读取，视图滚动到已读取部分的末尾时才读下一页（fetchMore），
+// 打开多大的库都只读第一页。已读取的页只在内存中保留最近使用的若干页，
+// 换出的页记住起始游标，再次显示时按键集重新读取。
+// 点击列标题排序时在后台读入当前筛选条件下的全部行，读完前仍显示分页读取的行，读完后一次排序显示；
+// 之后换列、换方向都只在内存中排序（见 ScoreSorter）。排序时换了筛选条件同样先显示第一页，再在后台读取。
+// 取消排序（sort(-1)）后回到分页读取
 class ScoreModel : public QAbstractTableModel
 {
     Q_OBJECT
 
 public:
+    // 每次 fetchMore 读取的行数
+    static const int PageSize = 500;
+
     explicit ScoreModel(QObject *parent = nullptr);
 
     // 重写虚函数
@@ -17,15 +29,104 @@ public:
     int columnCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
 
     // 自定义方法
+    // 清除筛选条件，从第一页重新读取
     void refreshData();
+    // 只应用上次读取以来数据库变更日志中的变化（插入/修改/删除对应的行），选中行和滚动位置保持不变；
+    // 变化的行太多或无法确定所在的页时，按当前筛选条件从第一页重新读取
+    void applyChanges();
     void filterData(const QString& className, const QString& course, const QString& keyword = "");
+    // 显示已经查询好的第一页（异步筛选完成后调用），version 为发出查询前的变更日志版本
+    void setFirstPage(const QString& className, const QString& course, const QString& keyword,
+                      const QList<StudentScore>& rows, qint64 version);
     StudentScore getScoreAt(int row) const;
+    // 当前筛选条件下的总行数（包括还没有读取的行）
+    qint64 totalCount() const;
+    // 当前显示的行对应的变更日志版本
+    qint64 changeVersion() const;
+
+    // 关键字搜索的本地路径：班级、课程不变，新关键字包含当前关键字（在原有输入上继续输入），
+    // 且当前筛选条件下的全部行都在内存中时，新结果一定是当前行的子集，不必访问数据库
+    bool canNarrowTo(const QString& className, const QString& course, const QString& keyword) const;
+    // 在后台线程中从当前行里筛选出匹配 keyword 的行，future 被取消后尽快结束
+    QFuture<QList<StudentScore>> narrowAsync(const QString& keyword) const;
+    // 显示 narrowAsync 的结果，version 为发出时的 changeVersion()，期间应用过变更时改为从数据库读取
+    void setNarrowedRows(const QString& className, const QString& course, const QString& keyword,
+                         const QList<StudentScore>& rows, qint64 version);
+    // 放弃正在后台进行的排序读取，继续分页显示（关闭窗口时调用）
+    void cancelSortLoad();
+
+signals:
+    // 排序所需的全部行开始在后台读取
+    void sortLoadStarted();
+    // 全部行已读取并排序显示（读取被新的筛选或取消排序取代时不发出）
+    void sortLoadFinished();
 
 private:
-    QList<StudentScore> m_scores;
+    // 一页已读取的行：after 为读取时上一页最后一行的键，本页包含 after 之后的 rowCount 行
+    struct Page {
+        ScoreCursor after;
+        int firstRow;
+        int rowCount;
+        bool loaded;
+        QList<StudentScore> rows;   // 换出后为空
+    };
+
+    // 内存中最多保留的页数
+    static const int MaxCachedPages = 40;
+    // 变化的行超过这个数时整体重新读取比逐行通知视图更快
+    static const int MaxIncrementalChanges = 2000;
+
+    // 按当前筛选条件从第一页重新读取
+    void reload();
+    void resetPages(const QString& className, const QString& course, const QString& keyword,
+                    const QList<StudentScore>& firstPage, qint64 version);
+    void appendPage(const QList<StudentScore>& rows);
+    // 第 row 行，排序模式下取自 m_sorter，否则取自所在的页
+    const StudentScore* scoreAt(int row) const;
+    // 取得第 page 页的数据，已换出时重新读取，并换出最久未用的页
+    const Page& loadedPage(int page) const;
+    void touchPage(int page) const;
+    int pageOfRow(int row) const;
+    // score 按排序应属于的页，排在已读取部分之后时返回-1
+    int pageOfKey(const StudentScore& score) const;
+    bool locate(int id, int& page, int& offset) const;
+    bool matchesFilter(const StudentScore& score) const;
+    static bool matchesKeyword(const StudentScore& score, const QString& keyword);
+    // 返回false表示无法在已读取的页中确定位置，需要重新读取
+    bool applyChange(const ScoreChange& change);
+    void updateFirstRows();
+    bool isSorted() const;
+    // 在内存中应用变更（可以为空）后重新排序；行数不变时按 ID 保持视图的选中行和当前行
+    void resort(int column, Qt::SortOrder order, const QList<ScoreChange>& changes);
+    // 在后台读取当前筛选条件下的全部行，读完后按 column 排序显示；已在读取时只更新排序列
+    void loadSorted(int column, Qt::SortOrder order);
+    void finishSortLoad();
+    bool isSortLoading() const;
+    // 已排序或正在等待读取的排序列，未排序时为-1
+    int sortColumn() const;
+    Qt::SortOrder sortOrder() const;
+
     QStringList m_headers;
+    QString m_className;
+    QString m_course;
+    QString m_keyword;
+    mutable QVector<Page> m_pages;
+    mutable QList<int> m_recentPages;   // 内存中的页，最近使用的在末尾
+    ScoreCursor m_frontier;             // 已读取部分最后一行的键，下一页从这里开始
+    bool m_hasMore;
+    int m_rowCount;
+    qint64 m_totalCount;
+    qint64 m_version;                   // 已应用到的变更日志版本
+    ScoreSorter m_sorter;               // 排序模式下的全部行，未排序时为空
+    QFutureWatcher<QList<StudentScore>> m_sortWatcher;
+    int m_sortColumn;                   // 正在后台读取时要排序的列，没有读取时为-1
+    Qt::SortOrder m_sortOrder;
+    qint64 m_sortVersion;               // 后台读取开始前的变更日志版本
 };
 
 #endif // SCOREMODEL_H
@@ -0,0 +1,439 @@
+#include "scoresnapshot.h"
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char Magic[8] = {'S', 'G', 'S', 'S', 'N', 'A', 'P', '\0'};
+const quint32 CurrentVersion = 1;
+const quint32 HeaderSize = 48;
+const quint32 DictionaryCount = 4;
+// 每行：四个字典下标 + 成绩 + 考试日期
+const quint32 BytesPerRow = 4 * 4 + 8 + 4;
+// 无效日期在日期列中的取值
+const qint32 InvalidDay = std::numeric_limits<qint32>::min();
+
+// 标准 CRC-32（与 zlib 相同的多项式），查表法
+const quint32 *crcTable()
+{
+    static const struct Table {
+        quint32 values[256];
+        Table()
+        {
+            for (quint32 i = 0; i < 256; ++i) {
+                quint32 c = i;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                values[i] = c;
+            }
+        }
+    } table;
+    return table.values;
+}
+
+quint32 crc32(const uchar *data, qint64 size)
+{
+    const quint32 *table = crcTable();
+    quint32 crc = 0xFFFFFFFFu;
+    for (qint64 i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+inline quint32 crc32(const QByteArray &data)
+{
+    return crc32(reinterpret_cast<const uchar *>(data.constData()), data.size());
+}
+
+inline quint32 readU32(const uchar *p)
+{
+    return qFromLittleEndian<quint32>(p);
+}
+
+inline quint64 readU64(const uchar *p)
+{
+    return qFromLittleEndian<quint64>(p);
+}
+
+void appendU32(QByteArray &out, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian<quint32>(value, bytes);
+    out.append(reinterpret_cast<const char *>(bytes), 4);
+}
+
+void appendU64(QByteArray &out, quint64 value)
+{
+    uchar bytes[8];
+    qToLittleEndian<quint64>(value, bytes);
+    out.append(reinterpret_cast<const char *>(bytes), 8);
+}
+
+} // namespace
+
+quint32 ScoreSnapshotWriter::Dictionary::lookup(const QString &text)
+{
+    auto it = index.constFind(text);
+    if (it != index.constEnd())
+        return it.value();
+
+    quint32 id = quint32(entries.size());
+    index.insert(text, id);
+    entries.append(text);
+    return id;
+}
+
+ScoreSnapshotWriter::ScoreSnapshotWriter(QIODevice *device, int blockRows)
+    : m_device(device)
+    , m_blockRows(blockRows > 0 ? blockRows : DefaultBlockRows)
+    , m_rowCount(0)
+    , m_blockCount(0)
+    , m_error(false)
+{
+    m_studentIdColumn.reserve(m_blockRows);
+    m_nameColumn.reserve(m_blockRows);
+    m_classColumn.reserve(m_blockRows);
+    m_courseColumn.reserve(m_blockRows);
+    m_scoreColumn.reserve(m_blockRows);
+    m_dateColumn.reserve(m_blockRows);
+}
+
+bool ScoreSnapshotWriter::begin()
+{
+    // 先写一个占位文件头，finish() 时回填行数、块数和字典偏移
+    return writeHeader(0);
+}
+
+bool ScoreSnapshotWriter::append(const StudentScore &score)
+{
+    if (m_error)
+        return false;
+
+    m_studentIdColumn.append(m_studentIds.lookup(score.studentId));
+    m_nameColumn.append(m_names.lookup(score.studentName));
+    m_classColumn.append(m_classes.lookup(score.className));
+    m_courseColumn.append(m_courses.lookup(score.course));
+    m_scoreColumn.append(score.score);
+    m_dateColumn.append(score.examDate.isValid() ? qint32(score.examDate.toJulianDay()) : InvalidDay);
+    m_rowCount++;
+
+    if (m_scoreColumn.size() >= m_blockRows)
+        return flushBlock();
+    return true;
+}
+
+bool ScoreSnapshotWriter::finish()
+{
+    if (!m_scoreColumn.isEmpty())
+        flushBlock();
+
+    quint64 dictionaryOffset = quint64(m_device->pos());
+    writeDictionary(m_studentIds);
+    writeDictionary(m_names);
+    writeDictionary(m_classes);
+    writeDictionary(m_courses);
+
+    if (m_error || !m_device->seek(0))
+        return false;
+    return writeHeader(dictionaryOffset);
+}
+
+qint64 ScoreSnapshotWriter::rowCount() const
+{
+    return m_rowCount;
+}
+
+bool ScoreSnapshotWriter::hasError() const
+{
+    return m_error;
+}
+
+bool ScoreSnapshotWriter::flushBlock()
+{
+    const int rows = m_scoreColumn.size();
+    QByteArray payload(int(rows * BytesPerRow), Qt::Uninitialized);
+    uchar *p = reinterpret_cast<uchar *>(payload.data());
+
+    const QVector<quint32> *indexColumns[] = {&m_studentIdColumn, &m_nameColumn, &m_classColumn, &m_courseColumn};
+    for (const QVector<quint32> *column : indexColumns) {
+        for (quint32 value : *column) {
+            qToLittleEndian<quint32>(value, p);
+            p += 4;
+        }
+    }
+    for (double value : m_scoreColumn) {
+        quint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        qToLittleEndian<quint64>(bits, p);
+        p += 8;
+    }
+    for (qint32 value : m_dateColumn) {
+        qToLittleEndian<quint32>(quint32(value), p);
+        p += 4;
+    }
+
+    QByteArray block;
+    block.reserve(payload.size() + 12);
+    appendU32(block, quint32(rows));
+    appendU32(block, quint32(payload.size()));
+    block.append(payload);
+    appendU32(block, crc32(payload));
+
+    // resize(0) 保留容量供下一块使用
+    m_studentIdColumn.resize(0);
+    m_nameColumn.resize(0);
+    m_classColumn.resize(0);
+    m_courseColumn.resize(0);
+    m_scoreColumn.resize(0);
+    m_dateColumn.resize(0);
+    m_blockCount++;
+
+    return write(block);
+}
+
+bool ScoreSnapshotWriter::writeDictionary(const Dictionary &dictionary)
+{
+    QByteArray entries;
+    for (const QString &text : dictionary.entries) {
+        QByteArray utf8 = text.toUtf8();
+        appendU32(entries, quint32(utf8.size()));
+        entries.append(utf8);
+    }
+
+    QByteArray section;
+    appendU32(section, quint32(dictionary.entries.size()));
+    appendU32(section, quint32(entries.size()));
+    section.append(entries);
+    appendU32(section, crc32(entries));
+    return write(section);
+}
+
+bool ScoreSnapshotWriter::writeHeader(quint64 dictionaryOffset)
+{
+    QByteArray header(Magic, sizeof(Magic));
+    appendU32(header, CurrentVersion);
+    appendU32(header, HeaderSize);
+    appendU64(header, quint64(m_rowCount));
+    appendU32(header, m_blockCount);
+    appendU32(header, quint32(m_blockRows));
+    appendU64(header, dictionaryOffset);
+    appendU32(header, DictionaryCount);
+    appendU32(header, crc32(header));
+    return write(header);
+}
+
+bool ScoreSnapshotWriter::write(const QByteArray &data)
+{
+    if (m_error)
+        return false;
+    if (m_device->write(data) != data.size())
+        m_error = true;
+    return !m_error;
+}
+
+ScoreSnapshotReader::ScoreSnapshotReader(const QString &filePath)
+    : m_file(filePath)
+    , m_map(nullptr)
+    , m_data(nullptr)
+    , m_size(0)
+    , m_version(0)
+    , m_rowCount(0)
+{
+}
+
+ScoreSnapshotReader::~ScoreSnapshotReader()
+{
+    close();
+}
+
+bool ScoreSnapshotReader::fail(const QString &error)
+{
+    m_error = error;
+    return false;
+}
+
+bool ScoreSnapshotReader::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly))
+        return fail(m_file.errorString());
+
+    m_size = m_file.size();
+    m_map = m_size > 0 ? m_file.map(0, m_size) : nullptr;
+    if (m_map) {
+        m_data = m_map;
+    } else {
+        m_buffer = m_file.readAll();
+        m_data = reinterpret_cast<const uchar *>(m_buffer.constData());
+        m_size = m_buffer.size();
+    }
+
+    // 文件头
+    if (m_size < HeaderSize || memcmp(m_data, Magic, sizeof(Magic)) != 0)
+        return fail("不是成绩快照文件");
+    m_version = readU32(m_data + 8);
+    if (m_version == 0 || m_version > CurrentVersion)
+        return fail(QString("不支持的快照版本: %1").arg(m_version));
+    quint32 headerSize = readU32(m_data + 12);
+    if (headerSize < HeaderSize || headerSize > m_size)
+        return fail("快照文件头损坏");
+    if (crc32(m_data, HeaderSize - 4) != readU32(m_data + HeaderSize - 4))
+        return fail("快照文件头校验失败");
+
+    quint64 rowCount = readU64(m_data + 16);
+    quint32 blockCount = readU32(m_data + 24);
+    quint64 dictionaryOffset = readU64(m_data + 32);
+    quint32 dictionaryCount = readU32(m_data + 40);
+    if (dictionaryOffset < headerSize || dictionaryOffset > quint64(m_size) || dictionaryCount != DictionaryCount)
+        return fail("快照文件头损坏");
+
+    // 数据块：只记录偏移，校验和在解码时再检查
+    m_blockOffsets.clear();
+    m_blockOffsets.reserve(int(blockCount));
+    qint64 offset = headerSize;
+    quint64 rows = 0;
+    for (quint32 i = 0; i < blockCount; ++i) {
+        if (offset + 8 > qint64(dictionaryOffset))
+            return fail("快照数据块被截断");
+        quint32 blockRows = readU32(m_data + offset);
+        quint32 payloadSize = readU32(m_data + offset + 4);
+        if (quint64(payloadSize) != quint64(blockRows) * BytesPerRow
+            || offset + 8 + qint64(payloadSize) + 4 > qint64(dictionaryOffset))
+            return fail(QString("快照数据块 %1 损坏").arg(i));
+        m_blockOffsets.append(offset);
+        rows += blockRows;
+        offset += 8 + qint64(payloadSize) + 4;
+    }
+    if (rows != rowCount)
+        return fail("快照行数与文件头不一致");
+    m_rowCount = qint64(rowCount);
+
+    if (!readDictionaries(qint64(dictionaryOffset), dictionaryCount))
+        return false;
+
+    m_error.clear();
+    return true;
+}
+
+bool ScoreSnapshotReader::readDictionaries(qint64 offset, quint32 count)
+{
+    m_dictionaries.clear();
+    m_dictionaries.resize(int(count));
+
+    for (quint32 d = 0; d < count; ++d) {
+        if (offset + 8 > m_size)
+            return fail("快照字典被截断");
+        quint32 entryCount = readU32(m_data + offset);
+        quint32 byteSize = readU32(m_data + offset + 4);
+        const uchar *p = m_data + offset + 8;
+        const uchar *end = p + byteSize;
+        if (offset + 8 + qint64(byteSize) + 4 > m_size)
+            return fail("快照字典被截断");
+        if (crc32(p, byteSize) != readU32(end))
+            return fail("快照字典校验失败");
+
+        QVector<QString> &entries = m_dictionaries[int(d)];
+        entries.reserve(int(entryCount));
+        for (quint32 i = 0; i < entryCount; ++i) {
+            if (end - p < 4)
+                return fail("快照字典损坏");
+            quint32 length = readU32(p);
+            p += 4;
+            if (quint64(end - p) < length)
+                return fail("快照字典损坏");
+            entries.append(QString::fromUtf8(reinterpret_cast<const char *>(p), int(length)));
+            p += length;
+        }
+        offset += 8 + qint64(byteSize) + 4;
+    }
+    return true;
+}
+
+void ScoreSnapshotReader::close()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_blockOffsets.clear();
+    m_dictionaries.clear();
+    m_file.close();
+}
+
+QString ScoreSnapshotReader::errorString() const
+{
+    return m_error;
+}
+
+quint32 ScoreSnapshotReader::version() const
+{
+    return m_version;
+}
+
+qint64 ScoreSnapshotReader::rowCount() const
+{
+    return m_rowCount;
+}
+
+int ScoreSnapshotReader::blockCount() const
+{
+    return m_blockOffsets.size();
+}
+
+bool ScoreSnapshotReader::readBlock(int index, QVector<StudentScore> &rows)
+{
+    rows.resize(0);
+    if (index < 0 || index >= m_blockOffsets.size())
+        return fail("快照数据块不存在");
+
+    const uchar *block = m_data + m_blockOffsets[index];
+    const int count = int(readU32(block));
+    const quint32 payloadSize = readU32(block + 4);
+    const uchar *payload = block + 8;
+    if (crc32(payload, payloadSize) != readU32(payload + payloadSize))
+        return fail(QString("快照数据块 %1 校验失败").arg(index));
+
+    const uchar *studentIds = payload;
+    const uchar *names = studentIds + count * 4;
+    const uchar *classes = names + count * 4;
+    const uchar *courses = classes + count * 4;
+    const uchar *scores = courses + count * 4;
+    const uchar *dates = scores + count * 8;
+
+    const QVector<QString> &studentIdDict = m_dictionaries[0];
+    const QVector<QString> &nameDict = m_dictionaries[1];
+    const QVector<QString> &classDict = m_dictionaries[2];
+    const QVector<QString> &courseDict = m_dictionaries[3];
+
+    rows.resize(count);
+    for (int i = 0; i < count; ++i) {
+        quint32 studentId = readU32(studentIds + i * 4);
+        quint32 name = readU32(names + i * 4);
+        quint32 className = readU32(classes + i * 4);
+        quint32 course = readU32(courses + i * 4);
+        if (studentId >= quint32(studentIdDict.size()) || name >= quint32(nameDict.size())
+            || className >= quint32(classDict.size()) || course >= quint32(courseDict.size())) {
+            rows.resize(0);
+            return fail(QString("快照数据块 %1 字典下标越界").arg(index));
+        }
+
+        // 字典中的字符串是隐式共享的，这里只增加引用计数
+        StudentScore &score = rows[i];
+        score.id = 0;
+        score.studentId = studentIdDict[studentId];
+        score.studentName = nameDict[name];
+        score.className = classDict[className];
+        score.course = courseDict[course];
+
+        quint64 bits = readU64(scores + i * 8);
+        memcpy(&score.score, &bits, sizeof(bits));
+
+        qint32 day = qint32(readU32(dates + i * 4));
+        score.examDate = day == InvalidDay ? QDate() : QDate::fromJulianDay(day);
+    }
+    return true;
+}
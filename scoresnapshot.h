@@ -0,0 +1,112 @@
+#ifndef SCORESNAPSHOT_H
+#define SCORESNAPSHOT_H
+
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+#include "databasemanager.h"
+
+// 成绩表的二进制列式快照（.sgss），用于在机器之间搬运数据和快速重新加载
+//
+// 文件布局（所有整数均为小端序）：
+//   文件头 48 字节：魔数 "SGSSNAP\0"、格式版本、文件头长度、总行数、数据块数、
+//                   每块行数、字典区偏移、字典个数、文件头CRC32
+//   数据块 × N：     行数(u32)、数据长度(u32)、列数据、列数据CRC32(u32)
+//                   列数据依次为：学号/姓名/班级/课程字典下标(u32 × 行数 × 4)、
+//                   成绩(f64 × 行数)、考试日期儒略日(i32 × 行数)
+//   字典区 × 4：     条目数(u32)、字节数(u32)、条目（长度u32 + UTF-8）、字典CRC32(u32)
+//
+// 字典写在文件末尾，导出时只需顺序写一遍，结束后回填文件头
+class ScoreSnapshotWriter
+{
+public:
+    enum { DefaultBlockRows = 65536 };
+
+    // device须可随机写（QFile），结束时要回到开头回填文件头
+    explicit ScoreSnapshotWriter(QIODevice *device, int blockRows = DefaultBlockRows);
+
+    bool begin();
+    bool append(const StudentScore &score);
+    bool finish();
+
+    qint64 rowCount() const;
+    bool hasError() const;
+
+private:
+    ScoreSnapshotWriter(const ScoreSnapshotWriter&) = delete;
+    ScoreSnapshotWriter& operator=(const ScoreSnapshotWriter&) = delete;
+
+    // 一个字符串列的字典：相同的字符串只保存一次
+    struct Dictionary {
+        QHash<QString, quint32> index;
+        QVector<QString> entries;
+        quint32 lookup(const QString &text);
+    };
+
+    bool flushBlock();
+    bool writeDictionary(const Dictionary &dictionary);
+    bool writeHeader(quint64 dictionaryOffset);
+    bool write(const QByteArray &data);
+
+    QIODevice *m_device;
+    int m_blockRows;
+    qint64 m_rowCount;
+    quint32 m_blockCount;
+    bool m_error;
+
+    Dictionary m_studentIds;
+    Dictionary m_names;
+    Dictionary m_classes;
+    Dictionary m_courses;
+
+    // 当前数据块的各列
+    QVector<quint32> m_studentIdColumn;
+    QVector<quint32> m_nameColumn;
+    QVector<quint32> m_classColumn;
+    QVector<quint32> m_courseColumn;
+    QVector<double> m_scoreColumn;
+    QVector<qint32> m_dateColumn;
+};
+
+// 以内存映射方式读取快照：打开时校验文件头并解码字典，数据块按需校验和解码
+class ScoreSnapshotReader
+{
+public:
+    explicit ScoreSnapshotReader(const QString &filePath);
+    ~ScoreSnapshotReader();
+
+    bool open();
+    void close();
+    QString errorString() const;
+
+    quint32 version() const;
+    qint64 rowCount() const;
+    int blockCount() const;
+
+    // 解码第 index 块到 rows（复用其容量），校验和不符或下标越界时返回false
+    bool readBlock(int index, QVector<StudentScore> &rows);
+
+private:
+    ScoreSnapshotReader(const ScoreSnapshotReader&) = delete;
+    ScoreSnapshotReader& operator=(const ScoreSnapshotReader&) = delete;
+
+    bool readDictionaries(qint64 offset, quint32 count);
+    bool fail(const QString &error);
+
+    QFile m_file;
+    uchar *m_map;
+    QByteArray m_buffer;
+    const uchar *m_data;
+    qint64 m_size;
+    QString m_error;
+
+    quint32 m_version;
+    qint64 m_rowCount;
+    QVector<qint64> m_blockOffsets;
+    // 学号、姓名、班级、课程四个字典
+    QVector<QVector<QString>> m_dictionaries;
+};
+
+#endif // SCORESNAPSHOT_H
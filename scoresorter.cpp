@@ -0,0 +1,232 @@
+#include "scoresorter.h"
+#include <QCollator>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+
+// 字符串列的排序键：先对去重后的值按排序规则排序（班级、课程只有几十个，学生也远少于成绩行），
+// 每行的键就是它的值在其中的名次，之后排序只比较整数
+QVector<qint64> rankStrings(const QList<StudentScore> &scores, QString StudentScore::*field)
+{
+    QHash<QString, qint64> ranks;
+    for (const StudentScore &score : scores)
+        ranks.insert(score.*field, 0);
+
+    QStringList values = ranks.keys();
+    QCollator collator;
+    collator.setNumericMode(true);
+    std::sort(values.begin(), values.end(), collator);
+    for (int i = 0; i < values.size(); ++i)
+        ranks[values.at(i)] = i;
+
+    QVector<qint64> keys;
+    keys.reserve(scores.size());
+    for (const StudentScore &score : scores)
+        keys.append(ranks.value(score.*field));
+    return keys;
+}
+
+struct Range {
+    int begin;
+    int middle;
+    int end;
+};
+
+// 分成与线程数相同的块分别排序，再逐轮两两归并（同一轮的归并互不重叠，同样并行）
+template <typename Iterator, typename Compare>
+void parallelSort(Iterator first, int count, Compare less)
+{
+    int chunkCount = qMax(1, QThread::idealThreadCount());
+    QVector<Range> chunks;
+    for (int i = 0; i < chunkCount; ++i)
+        chunks.append(Range{count * i / chunkCount, 0, count * (i + 1) / chunkCount});
+
+    QtConcurrent::blockingMap(chunks, [first, less](const Range &chunk) {
+        std::sort(first + chunk.begin, first + chunk.end, less);
+    });
+
+    while (chunks.size() > 1) {
+        QVector<Range> merges;
+        QVector<Range> next;
+        for (int i = 0; i + 1 < chunks.size(); i += 2) {
+            merges.append(Range{chunks.at(i).begin, chunks.at(i).end, chunks.at(i + 1).end});
+            next.append(Range{chunks.at(i).begin, 0, chunks.at(i + 1).end});
+        }
+        if (chunks.size() % 2)
+            next.append(chunks.last());
+
+        QtConcurrent::blockingMap(merges, [first, less](const Range &merge) {
+            std::inplace_merge(first + merge.begin, first + merge.middle, first + merge.end, less);
+        });
+        chunks = next;
+    }
+}
+
+} // namespace
+
+ScoreSorter::ScoreSorter(int columnCount)
+    : m_keys(columnCount)
+    , m_column(-1)
+    , m_sortOrder(Qt::AscendingOrder)
+{
+}
+
+void ScoreSorter::setScores(const QList<StudentScore> &scores)
+{
+    m_scores = scores;
+    invalidate();
+    m_indexOfId.clear();
+    if (m_column >= 0)
+        sort(m_column, m_sortOrder);
+}
+
+void ScoreSorter::clear()
+{
+    m_scores.clear();
+    invalidate();
+    m_indexOfId.clear();
+    m_column = -1;
+}
+
+void ScoreSorter::invalidate()
+{
+    for (QVector<qint64> &keys : m_keys)
+        keys.clear();
+    m_order.clear();
+}
+
+void ScoreSorter::buildIndex()
+{
+    if (!m_indexOfId.isEmpty())
+        return;
+    m_indexOfId.reserve(m_scores.size());
+    for (int i = 0; i < m_scores.size(); ++i)
+        m_indexOfId.insert(m_scores.at(i).id, i);
+}
+
+bool ScoreSorter::contains(int id)
+{
+    buildIndex();
+    return m_indexOfId.contains(id);
+}
+
+void ScoreSorter::update(const StudentScore &score)
+{
+    buildIndex();
+    auto it = m_indexOfId.constFind(score.id);
+    if (it != m_indexOfId.constEnd()) {
+        m_scores[it.value()] = score;
+    } else {
+        m_indexOfId.insert(score.id, m_scores.size());
+        m_scores.append(score);
+    }
+    invalidate();
+}
+
+void ScoreSorter::remove(int id)
+{
+    buildIndex();
+    auto it = m_indexOfId.find(id);
+    if (it == m_indexOfId.end())
+        return;
+    // 与最后一行交换后删除，其余行的下标不变
+    int index = it.value();
+    m_indexOfId.erase(it);
+    if (index != m_scores.size() - 1) {
+        m_scores[index] = m_scores.last();
+        m_indexOfId[m_scores.at(index).id] = index;
+    }
+    m_scores.removeLast();
+    invalidate();
+}
+
+const QVector<qint64> &ScoreSorter::keys(int column)
+{
+    QVector<qint64> &keys = m_keys[column];
+    if (!keys.isEmpty() || m_scores.isEmpty())
+        return keys;
+
+    switch (column) {
+    case 1: keys = rankStrings(m_scores, &StudentScore::studentId); break;
+    case 2: keys = rankStrings(m_scores, &StudentScore::studentName); break;
+    case 3: keys = rankStrings(m_scores, &StudentScore::className); break;
+    case 4: keys = rankStrings(m_scores, &StudentScore::course); break;
+    default:
+        keys.reserve(m_scores.size());
+        for (const StudentScore &score : m_scores) {
+            if (column == 5)
+                keys.append(qRound64(score.score * 100));   // 与表格显示的两位小数一致
+            else if (column == 6)
+                keys.append(score.examDate.toJulianDay());
+            else
+                keys.append(score.id);
+        }
+        break;
+    }
+    return keys;
+}
+
+void ScoreSorter::sort(int column, Qt::SortOrder order)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    m_column = column;
+    m_sortOrder = order;
+    const QVector<qint64> &columnKeys = keys(column);
+
+    m_order.resize(m_scores.size());
+    for (int i = 0; i < m_scores.size(); ++i)
+        m_order[i] = Entry{columnKeys.at(i), m_scores.at(i).id, i};
+
+    auto ascending = [](const Entry &a, const Entry &b) {
+        return a.key < b.key || (a.key == b.key && a.id < b.id);
+    };
+    auto descending = [](const Entry &a, const Entry &b) {
+        return a.key > b.key || (a.key == b.key && a.id > b.id);
+    };
+    bool parallel = m_order.size() >= ParallelThreshold;
+    if (order == Qt::AscendingOrder) {
+        if (parallel)
+            parallelSort(m_order.begin(), m_order.size(), ascending);
+        else
+            std::sort(m_order.begin(), m_order.end(), ascending);
+    } else {
+        if (parallel)
+            parallelSort(m_order.begin(), m_order.size(), descending);
+        else
+            std::sort(m_order.begin(), m_order.end(), descending);
+    }
+
+    qDebug() << "按第" << column << "列排序" << m_order.size() << "行，耗时" << timer.elapsed() << "ms";
+}
+
+int ScoreSorter::size() const
+{
+    return m_order.size();
+}
+
+const StudentScore &ScoreSorter::at(int row) const
+{
+    return m_scores.at(m_order.at(row).index);
+}
+
+int ScoreSorter::column() const
+{
+    return m_column;
+}
+
+Qt::SortOrder ScoreSorter::order() const
+{
+    return m_sortOrder;
+}
+
+const QList<StudentScore> &ScoreSorter::scores() const
+{
+    return m_scores;
+}
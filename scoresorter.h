@@ -0,0 +1,58 @@
+#ifndef SCORESORTER_H
+#define SCORESORTER_H
+
+#include <QHash>
+#include <QVector>
+#include "databasemanager.h"
+
+// 已读入内存的成绩按任意一列排序，不再回到 SQL。
+// 每列先换算成整数排序键并缓存：成绩取百分之一分的整数，考试日期取儒略日，
+// 字符串列取该值在本地化排序规则（数字按数值比较）下的名次。
+// 排序只移动 (键, ID, 下标) 组成的小条目，成绩记录本身不动；行数较多时分块并行排序后归并。
+// 同键的行按 ID 排列，升序、降序互为逆序
+class ScoreSorter
+{
+public:
+    // columnCount 为表格的列数，每列缓存一组排序键
+    explicit ScoreSorter(int columnCount);
+
+    void setScores(const QList<StudentScore>& scores);
+    void clear();
+    void sort(int column, Qt::SortOrder order);
+
+    int size() const;
+    bool contains(int id);
+    // 排序后第 row 行
+    const StudentScore& at(int row) const;
+    int column() const;
+    Qt::SortOrder order() const;
+    // 全部行（排序前的顺序）
+    const QList<StudentScore>& scores() const;
+
+    // 按 ID 替换（没有时追加）或删除一行，之后须重新 sort()
+    void update(const StudentScore& score);
+    void remove(int id);
+
+private:
+    struct Entry {
+        qint64 key;
+        int id;
+        int index;      // 在 m_scores 中的下标
+    };
+
+    // 行数不少于此值时并行排序
+    static const int ParallelThreshold = 100000;
+
+    const QVector<qint64>& keys(int column);
+    void invalidate();
+    void buildIndex();
+
+    QList<StudentScore> m_scores;
+    QVector<QVector<qint64>> m_keys;    // 按列缓存，用到时才计算
+    QVector<Entry> m_order;
+    QHash<int, int> m_indexOfId;        // ID -> m_scores 下标，第一次修改时建立
+    int m_column;
+    Qt::SortOrder m_sortOrder;
+};
+
+#endif // SCORESORTER_H
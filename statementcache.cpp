@@ -0,0 +1,130 @@
+#include "statementcache.h"
+#include <QSqlError>
+#include <QDebug>
+
+StatementCache::StatementCache(const QSqlDatabase &database, int capacity)
+    : m_database(database)
+    , m_capacity(capacity > 0 ? capacity : DefaultCapacity)
+    , m_clock(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+StatementCache::~StatementCache()
+{
+    clear();
+}
+
+void StatementCache::setDatabase(const QSqlDatabase &database)
+{
+    clear();
+    m_database = database;
+}
+
+QSqlQuery *StatementCache::acquire(const QString &sql)
+{
+    auto it = m_statements.find(sql);
+    if (it != m_statements.end()) {
+        m_hits++;
+        it->useCount++;
+        it->lastUsed = ++m_clock;
+        return it->query;
+    }
+
+    m_misses++;
+
+    // 查询形状的种类是有限的，容量按实际的形状数确定；超出时淘汰最久未用的语句
+    if (m_statements.size() >= m_capacity && !evictOne()) {
+        qDebug() << "语句缓存中的" << m_statements.size() << "条语句都在使用中，暂时超出容量";
+    }
+
+    QSqlQuery *query = new QSqlQuery(m_database);
+    // 只进游标：SQLite驱动不再在内存中缓存已读过的行
+    query->setForwardOnly(true);
+    if (!query->prepare(sql)) {
+        qDebug() << "预编译错误:" << query->lastError().text() << sql;
+        delete query;
+        return nullptr;
+    }
+
+    m_statements.insert(sql, Entry{query, 1, ++m_clock});
+    return query;
+}
+
+void StatementCache::release(const QString &sql)
+{
+    auto it = m_statements.find(sql);
+    if (it != m_statements.end() && it->useCount > 0)
+        it->useCount--;
+}
+
+bool StatementCache::evictOne()
+{
+    auto victim = m_statements.end();
+    for (auto it = m_statements.begin(); it != m_statements.end(); ++it) {
+        if (it->useCount == 0 && (victim == m_statements.end() || it->lastUsed < victim->lastUsed))
+            victim = it;
+    }
+    if (victim == m_statements.end())
+        return false;
+
+    delete victim->query;
+    m_statements.erase(victim);
+    return true;
+}
+
+void StatementCache::clear()
+{
+    for (const Entry &entry : m_statements) {
+        if (entry.useCount > 0)
+            qDebug() << "清空语句缓存时仍有语句在使用中";
+        delete entry.query;
+    }
+    m_statements.clear();
+}
+
+qint64 StatementCache::hitCount() const
+{
+    return m_hits;
+}
+
+qint64 StatementCache::missCount() const
+{
+    return m_misses;
+}
+
+int StatementCache::size() const
+{
+    return m_statements.size();
+}
+
+CachedQuery::CachedQuery(StatementCache &cache, const QString &sql)
+    : m_cache(cache)
+    , m_sql(sql)
+    , m_query(cache.acquire(sql))
+{
+}
+
+CachedQuery::~CachedQuery()
+{
+    if (m_query) {
+        m_query->finish();
+        m_cache.release(m_sql);
+    }
+}
+
+bool CachedQuery::isValid() const
+{
+    return m_query != nullptr;
+}
+
+QSqlQuery &CachedQuery::operator*() const
+{
+    return *m_query;
+}
+
+QSqlQuery *CachedQuery::operator->() const
+{
+    return m_query;
+}
@@ -0,0 +1,82 @@
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QHash>
+#include <QString>
+
+// 预编译语句缓存：以SQL文本为键（同一种筛选组合拼出的SQL完全相同，即“查询形状”），
+// 第一次使用时 prepare，之后只重新绑定参数执行。
+// 缓存满时淘汰最久未用、且没有被 CachedQuery 占用的语句；正在使用的语句不会被删除，
+// 全部被占用时暂时超出容量。
+// 缓存属于一个数据库连接，只能在该连接所在的线程使用
+class StatementCache
+{
+public:
+    // 一个连接上可能出现的查询形状：
+    // 表格筛选 12 种（班级 有/无 × 课程 有/无 × 关键字 无/FTS/LIKE）× 整表、分页、带游标分页、计数 4 条 = 48，
+    // 统计分析 4 种（班级 × 课程）× 统计、分布、课程趋势等约 5 条 = 20，
+    // 另有单行写入、维度表解析、变更日志、下拉框列表等约 20 条；容量留出余量
+    static const int DefaultCapacity = 128;
+
+    explicit StatementCache(const QSqlDatabase &database = QSqlDatabase(), int capacity = DefaultCapacity);
+    ~StatementCache();
+
+    // 切换连接会清空缓存
+    void setDatabase(const QSqlDatabase &database);
+
+    // 返回已预编译的语句并占用它，预编译失败返回nullptr（失败的语句不缓存）；
+    // 用完须调用 release()，通常经由 CachedQuery
+    QSqlQuery *acquire(const QString &sql);
+    void release(const QString &sql);
+    // 删除全部语句，只能在没有语句被占用时调用
+    void clear();
+
+    qint64 hitCount() const;
+    qint64 missCount() const;
+    int size() const;
+
+private:
+    StatementCache(const StatementCache&) = delete;
+    StatementCache& operator=(const StatementCache&) = delete;
+
+    struct Entry {
+        QSqlQuery *query;
+        int useCount;       // 正在使用它的 CachedQuery 个数
+        qint64 lastUsed;
+    };
+
+    // 淘汰最久未用且未被占用的语句，全部被占用时返回false
+    bool evictOne();
+
+    QSqlDatabase m_database;
+    QHash<QString, Entry> m_statements;
+    int m_capacity;
+    qint64 m_clock;
+    qint64 m_hits;
+    qint64 m_misses;
+};
+
+// 在作用域内占用缓存中的语句（期间不会被淘汰）；离开作用域时调用 finish() 重置语句，
+// 释放SQLite的读锁和结果集，语句本身仍留在缓存中
+class CachedQuery
+{
+public:
+    CachedQuery(StatementCache &cache, const QString &sql);
+    ~CachedQuery();
+
+    bool isValid() const;
+    QSqlQuery &operator*() const;
+    QSqlQuery *operator->() const;
+
+private:
+    CachedQuery(const CachedQuery&) = delete;
+    CachedQuery& operator=(const CachedQuery&) = delete;
+
+    StatementCache &m_cache;
+    QString m_sql;
+    QSqlQuery *m_query;
+};
+
+#endif // STATEMENTCACHE_H
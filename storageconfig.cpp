@@ -0,0 +1,253 @@
+#include "storageconfig.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QStorageInfo>
+#include <QFileInfo>
+#include <QDir>
+#include <QMap>
+#include <QDebug>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+namespace {
+
+const char *DefaultProfile = "default";
+
+// 旧版本写死的数据库位置
+const char *LegacyDatabasePath = "C:/Users/bill/Desktop/student_scores.db";
+const char *DatabaseFileName = "student_scores.db";
+
+// 校验枚举型参数，非法值保留原值并给出提示
+bool setChoice(QString &target, const QString &value, const QStringList &choices, const char *key)
+{
+    QString upper = value.trimmed().toUpper();
+    if (!choices.contains(upper)) {
+        qDebug() << "存储配置" << key << "取值无效:" << value << "，可选值:" << choices;
+        return false;
+    }
+    target = upper;
+    return true;
+}
+
+bool setNumber(qint64 &target, const QString &value, const char *key)
+{
+    bool ok = false;
+    qint64 number = value.trimmed().toLongLong(&ok);
+    if (!ok || number < 0) {
+        qDebug() << "存储配置" << key << "取值无效:" << value;
+        return false;
+    }
+    target = number;
+    return true;
+}
+
+// key 为配置文件中的键名；环境变量名为 SGS_ + 键名大写
+void applyOverride(StorageProfile &profile, const QString &key, const QString &value)
+{
+    static const QStringList journalModes = {"DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF"};
+    static const QStringList syncModes = {"OFF", "NORMAL", "FULL", "EXTRA"};
+    static const QStringList tempStores = {"DEFAULT", "FILE", "MEMORY"};
+
+    if (key == "journal_mode") {
+        setChoice(profile.journalMode, value, journalModes, "journal_mode");
+    } else if (key == "synchronous") {
+        setChoice(profile.synchronous, value, syncModes, "synchronous");
+    } else if (key == "temp_store") {
+        setChoice(profile.tempStore, value, tempStores, "temp_store");
+    } else if (key == "cache_size_kib") {
+        qint64 number = profile.cacheSizeKiB;
+        if (setNumber(number, value, "cache_size_kib"))
+            profile.cacheSizeKiB = int(qMin<qint64>(number, 1 << 30));
+    } else if (key == "mmap_size_mib") {
+        setNumber(profile.mmapSizeMiB, value, "mmap_size_mib");
+    }
+}
+
+const QStringList &overrideKeys()
+{
+    static const QStringList keys = {"journal_mode", "synchronous", "cache_size_kib", "mmap_size_mib", "temp_store"};
+    return keys;
+}
+
+QString envValue(const QString &key)
+{
+    return qEnvironmentVariable(("SGS_" + key.toUpper()).toLatin1().constData());
+}
+
+} // namespace
+
+StorageProfile StorageProfile::preset(const QString &name, bool *ok)
+{
+    StorageProfile profile;
+    profile.name = name;
+
+    bool known = true;
+    if (name == "local") {
+        profile.journalMode = "WAL";
+    } else if (name == "safe") {
+        profile.synchronous = "FULL";
+        profile.cacheSizeKiB = 16 * 1024;
+        profile.mmapSizeMiB = 0;
+        profile.tempStore = "DEFAULT";
+    } else if (name == "bulk-import") {
+        profile.journalMode = "WAL";
+        profile.synchronous = "OFF";
+        profile.cacheSizeKiB = 256 * 1024;
+        profile.mmapSizeMiB = 1024;
+    } else if (name != DefaultProfile) {
+        known = false;
+        profile.name = DefaultProfile;
+        qDebug() << "未知的存储预设:" << name << "，使用" << DefaultProfile;
+    }
+
+    if (ok)
+        *ok = known;
+    return profile;
+}
+
+QStringList StorageProfile::presetNames()
+{
+    return {"safe", DefaultProfile, "local", "bulk-import"};
+}
+
+QStringList StorageProfile::pragmas() const
+{
+    // cache_size 取负数表示以KiB为单位，与页大小无关
+    return {
+        QString("PRAGMA journal_mode = %1").arg(journalMode),
+        QString("PRAGMA synchronous = %1").arg(synchronous),
+        QString("PRAGMA cache_size = -%1").arg(cacheSizeKiB),
+        QString("PRAGMA mmap_size = %1").arg(mmapSizeMiB * 1024 * 1024),
+        QString("PRAGMA temp_store = %1").arg(tempStore)
+    };
+}
+
+bool StorageProfile::apply(QSqlDatabase &database) const
+{
+    bool success = true;
+    QSqlQuery query(database);
+    for (const QString &pragma : pragmas()) {
+        if (!query.exec(pragma)) {
+            qDebug() << "执行失败:" << pragma << query.lastError().text();
+            success = false;
+            continue;
+        }
+        // 内存数据库或只读介质上无法切换到WAL，SQLite会返回实际生效的模式
+        if (pragma.startsWith("PRAGMA journal_mode") && query.next()
+            && query.value(0).toString().toUpper() != journalMode) {
+            qDebug() << "日志模式未能切换为" << journalMode << "，当前为" << query.value(0).toString();
+        }
+        query.finish();
+    }
+    return success;
+}
+
+QString StorageConfig::defaultDatabasePath()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (dir.isEmpty())
+        dir = QDir::homePath();
+    return QDir(dir).filePath(DatabaseFileName);
+}
+
+QString StorageConfig::legacyDatabasePath()
+{
+    // 旧版本把数据库放在桌面上：先找写死的路径，再找当前用户的桌面
+    QStringList candidates = {LegacyDatabasePath};
+    QString desktop = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
+    if (!desktop.isEmpty())
+        candidates << QDir(desktop).filePath(DatabaseFileName);
+
+    for (const QString &candidate : candidates) {
+        if (QFileInfo(candidate).isFile())
+            return candidate;
+    }
+    return QString();
+}
+
+bool StorageConfig::isNetworkPath(const QString &path)
+{
+    QString absolute = QDir::fromNativeSeparators(QFileInfo(path).absoluteFilePath());
+    if (absolute.startsWith("//"))
+        return true;
+
+#ifdef Q_OS_WIN
+    // 映射的网络驱动器（如 Z:）看起来是本地路径
+    if (absolute.size() >= 2 && absolute.at(1) == ':') {
+        QString root = absolute.left(2) + "\\";
+        if (GetDriveTypeW(reinterpret_cast<const wchar_t *>(root.utf16())) == DRIVE_REMOTE)
+            return true;
+    }
+#endif
+
+    // 文件可能还不存在，按所在目录判断
+    static const QStringList networkTypes = {"nfs", "nfs4", "cifs", "smbfs", "smb2", "smb3", "9p",
+                                             "afpfs", "webdav", "davfs", "fuse.sshfs"};
+    QStorageInfo storage(QFileInfo(absolute).absolutePath());
+    return storage.isValid() && networkTypes.contains(QString::fromLatin1(storage.fileSystemType()).toLower());
+}
+
+StorageConfig StorageConfig::load()
+{
+    StorageConfig config;
+
+    QString configFile = qEnvironmentVariable("SGS_CONFIG");
+    if (configFile.isEmpty()) {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
+        if (!dir.isEmpty())
+            configFile = QDir(dir).filePath("storage.ini");
+    }
+
+    QString path;
+    QString profileName = DefaultProfile;
+    QMap<QString, QString> fileOverrides;
+    if (!configFile.isEmpty() && QFileInfo::exists(configFile)) {
+        QSettings settings(configFile, QSettings::IniFormat);
+        settings.beginGroup("storage");
+        path = settings.value("path").toString();
+        profileName = settings.value("profile", profileName).toString();
+        for (const QString &key : overrideKeys()) {
+            if (settings.contains(key))
+                fileOverrides.insert(key, settings.value(key).toString());
+        }
+        settings.endGroup();
+        config.configFile = configFile;
+    }
+
+    if (!qEnvironmentVariableIsEmpty("SGS_DB_PATH"))
+        path = qEnvironmentVariable("SGS_DB_PATH");
+    if (!qEnvironmentVariableIsEmpty("SGS_STORAGE_PROFILE"))
+        profileName = qEnvironmentVariable("SGS_STORAGE_PROFILE");
+
+    // 先取预设，再依次叠加配置文件和环境变量中的单项设置
+    config.profile = StorageProfile::preset(profileName.trimmed());
+    for (auto it = fileOverrides.constBegin(); it != fileOverrides.constEnd(); ++it)
+        applyOverride(config.profile, it.key(), it.value());
+    for (const QString &key : overrideKeys()) {
+        QString value = envValue(key);
+        if (!value.isEmpty())
+            applyOverride(config.profile, key, value);
+    }
+
+    if (!path.isEmpty()) {
+        config.databasePath = QDir::cleanPath(path);
+    } else {
+        // 升级后第一次启动：数据仍在旧版本的固定路径上，继续使用，不复制（其他客户端可能也在用这个文件）
+        config.databasePath = defaultDatabasePath();
+        QString legacyPath = legacyDatabasePath();
+        if (!QFileInfo::exists(config.databasePath) && !legacyPath.isEmpty()) {
+            qDebug() << "使用旧版本位置上的数据库:" << legacyPath
+                     << "，可在配置文件中用 path 指定其他位置";
+            config.databasePath = legacyPath;
+        }
+    }
+
+    if (config.profile.journalMode == "WAL" && isNetworkPath(config.databasePath)) {
+        qDebug() << "数据库位于网络文件系统，WAL 不可用，日志模式改为 DELETE:" << config.databasePath;
+        config.profile.journalMode = "DELETE";
+    }
+    return config;
+}
@@ -0,0 +1,53 @@
+#ifndef STORAGECONFIG_H
+#define STORAGECONFIG_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+
+// SQLite存储参数，每条连接打开后按此执行PRAGMA
+// 默认值即 default 预设
+struct StorageProfile {
+    QString name = "default";
+    QString journalMode = "DELETE";     // DELETE / TRUNCATE / PERSIST / MEMORY / WAL / OFF
+    QString synchronous = "NORMAL";     // OFF / NORMAL / FULL / EXTRA
+    int cacheSizeKiB = 64 * 1024;       // 每条连接的页缓存大小
+    qint64 mmapSizeMiB = 256;           // 内存映射读取的上限，0为关闭
+    QString tempStore = "MEMORY";       // DEFAULT / FILE / MEMORY
+
+    // 内置预设：
+    //   safe         DELETE + FULL，不使用mmap，掉电也不丢已提交的事务
+    //   default      DELETE + NORMAL，64MB缓存，256MB mmap，数据库可以放在共享盘上
+    //   local        WAL + NORMAL，其余同 default，读写互不阻塞，只适合本地磁盘上的数据库
+    //   bulk-import  WAL + OFF，256MB缓存，1GB mmap，只适合可以重新导入的大批量装载
+    // WAL 依赖共享内存，不能用于网络文件系统；数据库位于网络路径时 WAL 自动退回 DELETE
+    static StorageProfile preset(const QString &name, bool *ok = nullptr);
+    static QStringList presetNames();
+
+    QStringList pragmas() const;
+    // 在已打开的连接上执行全部PRAGMA
+    bool apply(QSqlDatabase &database) const;
+};
+
+// 存储配置：数据库位置和存储参数
+// 优先级从低到高：预设 < 配置文件 < 环境变量
+//   配置文件：环境变量 SGS_CONFIG 指定的路径，否则为应用配置目录下的 storage.ini，
+//            [storage] 节中的 path / profile / journal_mode / synchronous /
+//            cache_size_kib / mmap_size_mib / temp_store
+//   环境变量：SGS_DB_PATH / SGS_STORAGE_PROFILE / SGS_JOURNAL_MODE / SGS_SYNCHRONOUS /
+//            SGS_CACHE_SIZE_KIB / SGS_MMAP_SIZE_MIB / SGS_TEMP_STORE
+// 都没有指定路径时使用应用数据目录；那里还没有数据库而旧版本的固定路径上有时，继续使用旧路径上的数据库
+struct StorageConfig {
+    QString databasePath;
+    StorageProfile profile;
+    QString configFile;     // 实际读取的配置文件，未读取时为空
+
+    static StorageConfig load();
+    static QString defaultDatabasePath();
+    // 旧版本固定使用的数据库位置，不存在时为空
+    static QString legacyDatabasePath();
+    // 数据库文件是否位于网络文件系统（UNC路径、网络驱动器、NFS/SMB挂载）
+    static bool isNetworkPath(const QString &path);
+};
+
+#endif // STORAGECONFIG_H
@@ -0,0 +1,736 @@
+#include "xlsxreader.h"
+#include <QXmlStreamReader>
+#include <QtEndian>
+#include <QDebug>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// 原始DEFLATE（RFC 1951）流式解压
+// 输出先写入 窗口(32KB)+缓冲 的线性区，满了就交给 sink 并保留最后32KB供回溯引用
+class Inflater
+{
+public:
+    typedef std::function<bool(const char *, int)> Sink;
+
+    Inflater(const uchar *data, qint64 size, const Sink &sink)
+        : m_in(data)
+        , m_inEnd(data + size)
+        , m_bitBuffer(0)
+        , m_bitCount(0)
+        , m_out(WindowSize + FlushSize)
+        , m_pos(0)
+        , m_emitted(0)
+        , m_sink(sink)
+    {
+    }
+
+    bool run()
+    {
+        bool last = false;
+        while (!last) {
+            if (!need(3))
+                return false;
+            last = bits(1);
+            int type = bits(2);
+            bool ok = false;
+            if (type == 0) {
+                ok = storedBlock();
+            } else if (type == 1) {
+                ok = fixedBlock();
+            } else if (type == 2) {
+                ok = dynamicBlock();
+            }
+            if (!ok)
+                return false;
+        }
+        return flush();
+    }
+
+private:
+    enum {
+        WindowSize = 32768,
+        FlushSize = 256 * 1024,
+        MaxBits = 15
+    };
+
+    // 查找表：下标为按位倒序的 tableBits 位输入，值为 (符号 << 4) | 码长，0 表示无效
+    struct Huffman {
+        std::vector<quint32> table;
+        int tableBits = 0;
+    };
+
+    bool need(int count)
+    {
+        while (m_bitCount < count) {
+            if (m_in >= m_inEnd)
+                return false;
+            m_bitBuffer |= quint64(*m_in++) << m_bitCount;
+            m_bitCount += 8;
+        }
+        return true;
+    }
+
+    // 调用前须保证 need(count)
+    int bits(int count)
+    {
+        int value = int(m_bitBuffer & ((quint64(1) << count) - 1));
+        m_bitBuffer >>= count;
+        m_bitCount -= count;
+        return value;
+    }
+
+    void refill()
+    {
+        while (m_bitCount <= 56 && m_in < m_inEnd) {
+            m_bitBuffer |= quint64(*m_in++) << m_bitCount;
+            m_bitCount += 8;
+        }
+    }
+
+    static bool build(Huffman &h, const quint8 *lengths, int count)
+    {
+        int lengthCount[MaxBits + 1] = {0};
+        int maxLength = 0;
+        for (int i = 0; i < count; ++i) {
+            lengthCount[lengths[i]]++;
+            maxLength = std::max<int>(maxLength, lengths[i]);
+        }
+        lengthCount[0] = 0;
+
+        int nextCode[MaxBits + 2] = {0};
+        int code = 0;
+        for (int len = 1; len <= MaxBits; ++len) {
+            code = (code + lengthCount[len - 1]) << 1;
+            nextCode[len] = code;
+        }
+
+        h.tableBits = std::max(maxLength, 1);
+        h.table.assign(size_t(1) << h.tableBits, 0);
+        for (int symbol = 0; symbol < count; ++symbol) {
+            int len = lengths[symbol];
+            if (len == 0)
+                continue;
+            int c = nextCode[len]++;
+            if (c >= (1 << len))
+                return false; // 码长集合超额（over-subscribed）
+            // DEFLATE的霍夫曼码按高位在前写入，查表需要倒序
+            int reversed = 0;
+            for (int i = 0; i < len; ++i)
+                reversed |= ((c >> i) & 1) << (len - 1 - i);
+            for (int j = reversed; j < (1 << h.tableBits); j += (1 << len))
+                h.table[size_t(j)] = quint32(symbol << 4) | quint32(len);
+        }
+        return true;
+    }
+
+    int decode(const Huffman &h)
+    {
+        if (m_bitCount < h.tableBits) {
+            refill();
+        }
+        quint32 entry = h.table[size_t(m_bitBuffer & ((quint64(1) << h.tableBits) - 1))];
+        int len = int(entry & 15);
+        if (len == 0 || len > m_bitCount)
+            return -1;
+        m_bitBuffer >>= len;
+        m_bitCount -= len;
+        return int(entry >> 4);
+    }
+
+    bool put(char byte)
+    {
+        if (m_pos == m_out.size() && !flush())
+            return false;
+        m_out[m_pos++] = byte;
+        return true;
+    }
+
+    bool flush()
+    {
+        if (m_pos > m_emitted && !m_sink(m_out.data() + m_emitted, int(m_pos - m_emitted)))
+            return false;
+        size_t keep = std::min<size_t>(m_pos, WindowSize);
+        memmove(m_out.data(), m_out.data() + m_pos - keep, keep);
+        m_pos = keep;
+        m_emitted = keep;
+        return true;
+    }
+
+    bool storedBlock()
+    {
+        // 丢弃到字节边界
+        bits(m_bitCount & 7);
+        if (!need(32))
+            return false;
+        int len = bits(16);
+        int nlen = bits(16);
+        if (len != (~nlen & 0xffff))
+            return false;
+        // 位缓冲中可能还存有完整字节
+        while (len > 0 && m_bitCount >= 8) {
+            if (!put(char(bits(8))))
+                return false;
+            --len;
+        }
+        if (m_inEnd - m_in < len)
+            return false;
+        while (len-- > 0) {
+            if (!put(char(*m_in++)))
+                return false;
+        }
+        return true;
+    }
+
+    static Huffman fixedTable(bool distance)
+    {
+        quint8 lengths[288];
+        Huffman h;
+        if (distance) {
+            std::fill(lengths, lengths + 30, quint8(5));
+            build(h, lengths, 30);
+        } else {
+            std::fill(lengths, lengths + 144, quint8(8));
+            std::fill(lengths + 144, lengths + 256, quint8(9));
+            std::fill(lengths + 256, lengths + 280, quint8(7));
+            std::fill(lengths + 280, lengths + 288, quint8(8));
+            build(h, lengths, 288);
+        }
+        return h;
+    }
+
+    bool fixedBlock()
+    {
+        // 局部静态变量的初始化是线程安全的
+        static const Huffman literals = fixedTable(false);
+        static const Huffman distances = fixedTable(true);
+        return codes(literals, distances);
+    }
+
+    bool dynamicBlock()
+    {
+        static const quint8 order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+        if (!need(14))
+            return false;
+        int nlen = bits(5) + 257;
+        int ndist = bits(5) + 1;
+        int ncode = bits(4) + 4;
+        if (nlen > 286 || ndist > 30)
+            return false;
+
+        quint8 lengths[320] = {0};
+        for (int i = 0; i < ncode; ++i) {
+            if (!need(3))
+                return false;
+            lengths[order[i]] = quint8(bits(3));
+        }
+
+        Huffman codeLengths;
+        if (!build(codeLengths, lengths, 19))
+            return false;
+
+        int index = 0;
+        quint8 all[320] = {0};
+        while (index < nlen + ndist) {
+            int symbol = decode(codeLengths);
+            if (symbol < 0)
+                return false;
+            if (symbol < 16) {
+                all[index++] = quint8(symbol);
+                continue;
+            }
+            int repeat = 0;
+            quint8 value = 0;
+            if (symbol == 16) {
+                if (index == 0 || !need(2))
+                    return false;
+                value = all[index - 1];
+                repeat = 3 + bits(2);
+            } else if (symbol == 17) {
+                if (!need(3))
+                    return false;
+                repeat = 3 + bits(3);
+            } else {
+                if (!need(7))
+                    return false;
+                repeat = 11 + bits(7);
+            }
+            if (index + repeat > nlen + ndist)
+                return false;
+            while (repeat-- > 0)
+                all[index++] = value;
+        }
+
+        Huffman literals;
+        Huffman distances;
+        if (!build(literals, all, nlen) || !build(distances, all + nlen, ndist))
+            return false;
+        return codes(literals, distances);
+    }
+
+    bool codes(const Huffman &literals, const Huffman &distances)
+    {
+        static const quint16 lengthBase[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const quint8 lengthExtra[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const quint16 distBase[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+            8193, 12289, 16385, 24577};
+        static const quint8 distExtra[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+        for (;;) {
+            int symbol = decode(literals);
+            if (symbol < 0)
+                return false;
+            if (symbol < 256) {
+                if (!put(char(symbol)))
+                    return false;
+                continue;
+            }
+            if (symbol == 256)
+                return true;
+
+            symbol -= 257;
+            if (symbol >= 29 || !need(lengthExtra[symbol]))
+                return false;
+            int length = lengthBase[symbol] + bits(lengthExtra[symbol]);
+
+            int distSymbol = decode(distances);
+            if (distSymbol < 0 || distSymbol >= 30 || !need(distExtra[distSymbol]))
+                return false;
+            size_t distance = distBase[distSymbol] + bits(distExtra[distSymbol]);
+            if (distance > m_pos)
+                return false;
+
+            while (length-- > 0) {
+                if (m_pos == m_out.size()) {
+                    if (!flush())
+                        return false;
+                }
+                m_out[m_pos] = m_out[m_pos - distance];
+                ++m_pos;
+            }
+        }
+    }
+
+    const uchar *m_in;
+    const uchar *m_inEnd;
+    quint64 m_bitBuffer;
+    int m_bitCount;
+
+    std::vector<char> m_out;
+    size_t m_pos;
+    size_t m_emitted;
+    Sink m_sink;
+};
+
+inline quint16 readU16(const uchar *p)
+{
+    return qFromLittleEndian<quint16>(p);
+}
+
+inline quint32 readU32(const uchar *p)
+{
+    return qFromLittleEndian<quint32>(p);
+}
+
+// 把一块数据交给 xml，并处理目前能解析出的所有记号
+// 数据不完整（PrematureEndOfDocument）时返回true，等待下一块数据后继续
+bool feedXml(QXmlStreamReader &xml, const char *data, int size,
+             const std::function<bool(QXmlStreamReader &)> &onToken)
+{
+    xml.addData(QByteArray(data, size));
+    for (;;) {
+        QXmlStreamReader::TokenType token = xml.readNext();
+        if (token == QXmlStreamReader::Invalid || token == QXmlStreamReader::EndDocument)
+            break;
+        if (!onToken(xml))
+            return false;
+    }
+    return !xml.hasError() || xml.error() == QXmlStreamReader::PrematureEndOfDocumentError;
+}
+
+// 把 "AB12" 这样的单元格引用转换为从0开始的列号
+int columnFromReference(const QXmlStreamAttributes &attributes)
+{
+    const auto reference = attributes.value(QLatin1String("r"));
+    int column = 0;
+    int i = 0;
+    for (; i < reference.size(); ++i) {
+        QChar ch = reference.at(i);
+        if (ch < QLatin1Char('A') || ch > QLatin1Char('Z'))
+            break;
+        column = column * 26 + (ch.unicode() - 'A' + 1);
+    }
+    return i > 0 ? column - 1 : -1;
+}
+
+// 从 <dimension ref="A1:F1001"> 中取出最后一行的行号
+int lastRowFromDimension(const QXmlStreamAttributes &attributes)
+{
+    const QString reference = attributes.value(QLatin1String("ref")).toString();
+    int colon = reference.indexOf(QLatin1Char(':'));
+    QString last = colon >= 0 ? reference.mid(colon + 1) : reference;
+    int digits = 0;
+    while (digits < last.size() && !last.at(digits).isDigit())
+        ++digits;
+    return last.mid(digits).toInt();
+}
+
+} // namespace
+
+XlsxReader::XlsxReader(const QString &filePath)
+    : m_file(filePath)
+    , m_map(nullptr)
+    , m_size(0)
+{
+}
+
+XlsxReader::~XlsxReader()
+{
+    close();
+}
+
+bool XlsxReader::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_map = m_size > 0 ? m_file.map(0, m_size) : nullptr;
+    if (!m_map) {
+        m_error = "无法映射文件";
+        return false;
+    }
+
+    if (!readCentralDirectory() || !locateFirstSheet() || !readSharedStrings())
+        return false;
+
+    m_error.clear();
+    return true;
+}
+
+void XlsxReader::close()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_file.close();
+    m_entries.clear();
+    m_sharedStrings.clear();
+}
+
+QString XlsxReader::errorString() const
+{
+    return m_error;
+}
+
+bool XlsxReader::readCentralDirectory()
+{
+    // 从文件末尾向前查找“中央目录结束记录”（其后最多跟65535字节的注释）
+    const qint64 eocdSize = 22;
+    if (m_size < eocdSize) {
+        m_error = "不是有效的xlsx文件";
+        return false;
+    }
+
+    qint64 eocd = -1;
+    qint64 lowest = qMax<qint64>(0, m_size - eocdSize - 65535);
+    for (qint64 p = m_size - eocdSize; p >= lowest; --p) {
+        if (readU32(m_map + p) == 0x06054b50) {
+            eocd = p;
+            break;
+        }
+    }
+    if (eocd < 0) {
+        m_error = "找不到ZIP目录";
+        return false;
+    }
+
+    quint16 entryCount = readU16(m_map + eocd + 10);
+    quint32 directorySize = readU32(m_map + eocd + 12);
+    quint32 directoryOffset = readU32(m_map + eocd + 16);
+    if (qint64(directoryOffset) + directorySize > m_size) {
+        m_error = "ZIP目录损坏";
+        return false;
+    }
+
+    qint64 p = directoryOffset;
+    for (int i = 0; i < entryCount; ++i) {
+        if (p + 46 > m_size || readU32(m_map + p) != 0x02014b50) {
+            m_error = "ZIP目录损坏";
+            return false;
+        }
+
+        ZipEntry entry;
+        entry.method = readU16(m_map + p + 10);
+        entry.compressedSize = readU32(m_map + p + 20);
+        entry.uncompressedSize = readU32(m_map + p + 24);
+        quint16 nameLength = readU16(m_map + p + 28);
+        quint16 extraLength = readU16(m_map + p + 30);
+        quint16 commentLength = readU16(m_map + p + 32);
+        entry.localHeaderOffset = readU32(m_map + p + 42);
+
+        if (p + 46 + nameLength > m_size) {
+            m_error = "ZIP目录损坏";
+            return false;
+        }
+        QString name = QString::fromUtf8(reinterpret_cast<const char *>(m_map + p + 46), nameLength);
+        m_entries.insert(name, entry);
+
+        p += 46 + nameLength + extraLength + commentLength;
+    }
+
+    return true;
+}
+
+bool XlsxReader::readEntry(const QString &name, const DataSink &sink)
+{
+    auto it = m_entries.constFind(name);
+    if (it == m_entries.constEnd()) {
+        m_error = QString("xlsx中缺少 %1").arg(name);
+        return false;
+    }
+
+    const ZipEntry &entry = it.value();
+    qint64 local = entry.localHeaderOffset;
+    if (local + 30 > m_size || readU32(m_map + local) != 0x04034b50) {
+        m_error = QString("%1 的文件头损坏").arg(name);
+        return false;
+    }
+
+    // 本地文件头中的名称和扩展字段长度可能与中央目录不同，须以本地为准
+    qint64 dataOffset = local + 30 + readU16(m_map + local + 26) + readU16(m_map + local + 28);
+    if (dataOffset + entry.compressedSize > m_size) {
+        m_error = QString("%1 的数据不完整").arg(name);
+        return false;
+    }
+    const uchar *data = m_map + dataOffset;
+
+    if (entry.method == 0) {
+        // 未压缩，按块直接交给 sink
+        const qint64 blockSize = 256 * 1024;
+        for (qint64 offset = 0; offset < entry.compressedSize; offset += blockSize) {
+            int size = int(qMin<qint64>(blockSize, entry.compressedSize - offset));
+            if (!sink(reinterpret_cast<const char *>(data + offset), size))
+                return false;
+        }
+        return true;
+    }
+
+    if (entry.method == 8) {
+        Inflater inflater(data, entry.compressedSize, sink);
+        if (!inflater.run()) {
+            m_error = QString("%1 解压失败").arg(name);
+            return false;
+        }
+        return true;
+    }
+
+    m_error = QString("%1 使用了不支持的压缩方式 %2").arg(name).arg(entry.method);
+    return false;
+}
+
+bool XlsxReader::readEntryFully(const QString &name, QByteArray &data)
+{
+    data.clear();
+    auto it = m_entries.constFind(name);
+    if (it != m_entries.constEnd())
+        data.reserve(int(it.value().uncompressedSize));
+
+    return readEntry(name, [&data](const char *chunk, int size) {
+        data.append(chunk, size);
+        return true;
+    });
+}
+
+bool XlsxReader::locateFirstSheet()
+{
+    // workbook.xml 中第一个 <sheet> 的 r:id，再到 workbook.xml.rels 中查出对应的文件
+    QString relationId;
+    QByteArray workbook;
+    if (readEntryFully("xl/workbook.xml", workbook)) {
+        QXmlStreamReader xml(workbook);
+        while (!xml.atEnd() && relationId.isEmpty()) {
+            if (xml.readNext() == QXmlStreamReader::StartElement && xml.name() == QLatin1String("sheet")) {
+                for (const QXmlStreamAttribute &attribute : xml.attributes()) {
+                    if (attribute.name() == QLatin1String("id")) {
+                        relationId = attribute.value().toString();
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    QByteArray relations;
+    if (!relationId.isEmpty() && readEntryFully("xl/_rels/workbook.xml.rels", relations)) {
+        QXmlStreamReader xml(relations);
+        while (!xml.atEnd() && m_sheetPath.isEmpty()) {
+            if (xml.readNext() == QXmlStreamReader::StartElement
+                && xml.name() == QLatin1String("Relationship")
+                && xml.attributes().value(QLatin1String("Id")) == relationId) {
+                QString target = xml.attributes().value(QLatin1String("Target")).toString();
+                m_sheetPath = target.startsWith('/') ? target.mid(1) : "xl/" + target;
+            }
+        }
+    }
+
+    // 目录信息不全时退回到常见的默认文件名
+    if (m_sheetPath.isEmpty() || !m_entries.contains(m_sheetPath)) {
+        m_sheetPath = "xl/worksheets/sheet1.xml";
+    }
+    if (!m_entries.contains(m_sheetPath)) {
+        m_sheetPath.clear();
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+            if (it.key().startsWith("xl/worksheets/") && it.key().endsWith(".xml")
+                && (m_sheetPath.isEmpty() || it.key() < m_sheetPath)) {
+                m_sheetPath = it.key();
+            }
+        }
+    }
+
+    if (m_sheetPath.isEmpty()) {
+        m_error = "xlsx中没有工作表";
+        return false;
+    }
+    return true;
+}
+
+bool XlsxReader::readSharedStrings()
+{
+    m_sharedStrings.clear();
+    // 全部是数字或内联字符串的工作簿没有共享字符串表
+    if (!m_entries.contains("xl/sharedStrings.xml"))
+        return true;
+
+    QXmlStreamReader xml;
+    QString current;
+    bool inText = false;
+    int skipDepth = 0; // 跳过 <rPh> 注音等非正文内容
+
+    auto onToken = [&](QXmlStreamReader &reader) {
+        if (reader.isStartElement()) {
+            if (reader.name() == QLatin1String("si")) {
+                current.clear();
+            } else if (reader.name() == QLatin1String("rPh")) {
+                skipDepth++;
+            } else if (reader.name() == QLatin1String("t") && skipDepth == 0) {
+                inText = true;
+            }
+        } else if (reader.isCharacters()) {
+            if (inText)
+                current += reader.text();
+        } else if (reader.isEndElement()) {
+            if (reader.name() == QLatin1String("t")) {
+                inText = false;
+            } else if (reader.name() == QLatin1String("rPh")) {
+                skipDepth--;
+            } else if (reader.name() == QLatin1String("si")) {
+                m_sharedStrings.append(current);
+            }
+        }
+        return true;
+    };
+
+    bool xmlError = false;
+    bool ok = readEntry("xl/sharedStrings.xml", [&](const char *data, int size) {
+        xmlError = !feedXml(xml, data, size, onToken);
+        return !xmlError;
+    });
+    if (xmlError)
+        m_error = QString("共享字符串表解析错误: %1").arg(xml.errorString());
+    return ok;
+}
+
+bool XlsxReader::readRows(const RowCallback &callback)
+{
+    if (m_sheetPath.isEmpty()) {
+        m_error = "xlsx尚未打开";
+        return false;
+    }
+
+    enum CellType { CellValue, CellSharedString };
+
+    QXmlStreamReader xml;
+    QVector<QString> row;
+    QString value;
+    int rowNumber = 0;
+    int totalRows = 0;
+    int column = -1;
+    CellType cellType = CellValue;
+    bool inValue = false;
+    bool stopped = false;
+
+    auto onToken = [&](QXmlStreamReader &reader) {
+        if (reader.isStartElement()) {
+            const auto name = reader.name();
+            if (name == QLatin1String("c")) {
+                const QXmlStreamAttributes attributes = reader.attributes();
+                int referenced = columnFromReference(attributes);
+                column = referenced >= 0 ? referenced : column + 1;
+                cellType = attributes.value(QLatin1String("t")) == QLatin1String("s") ? CellSharedString : CellValue;
+                value.clear();
+            } else if (name == QLatin1String("v") || name == QLatin1String("t")) {
+                inValue = true;
+            } else if (name == QLatin1String("row")) {
+                int number = reader.attributes().value(QLatin1String("r")).toString().toInt();
+                rowNumber = number > 0 ? number : rowNumber + 1;
+                row.resize(0);
+                column = -1;
+            } else if (name == QLatin1String("dimension")) {
+                totalRows = lastRowFromDimension(reader.attributes());
+            }
+        } else if (reader.isCharacters()) {
+            if (inValue)
+                value += reader.text();
+        } else if (reader.isEndElement()) {
+            const auto name = reader.name();
+            if (name == QLatin1String("v") || name == QLatin1String("t")) {
+                inValue = false;
+            } else if (name == QLatin1String("c")) {
+                if (column >= 0) {
+                    if (row.size() <= column)
+                        row.resize(column + 1);
+                    if (cellType == CellSharedString) {
+                        int index = value.toInt();
+                        if (index >= 0 && index < m_sharedStrings.size())
+                            row[column] = m_sharedStrings.at(index);
+                    } else {
+                        row[column] = value;
+                    }
+                }
+            } else if (name == QLatin1String("row")) {
+                if (!callback(row, rowNumber, totalRows)) {
+                    stopped = true;
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    bool xmlError = false;
+    bool ok = readEntry(m_sheetPath, [&](const char *data, int size) {
+        xmlError = !feedXml(xml, data, size, onToken) && !stopped;
+        return !xmlError && !stopped;
+    });
+
+    if (stopped)
+        return true;
+    if (xmlError)
+        m_error = QString("工作表解析错误: %1").arg(xml.errorString());
+    return ok;
+}
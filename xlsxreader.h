@@ -0,0 +1,60 @@
+#ifndef XLSXREADER_H
+#define XLSXREADER_H
+
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+#include <functional>
+
+// 流式 .xlsx 读取器，不依赖第三方库：
+// 内存映射整个文件，自行解析ZIP中央目录并解压（DEFLATE），
+// 用 QXmlStreamReader 增量解析共享字符串表和第一个工作表。
+// 工作表按块解压、按行回调，内存占用与工作表大小无关（共享字符串表除外）
+class XlsxReader
+{
+public:
+    // cells按列号存放（A列为0），rowNumber为表格中的行号（从1开始），
+    // totalRows取自工作表的 <dimension>，未知时为0；返回false停止读取
+    typedef std::function<bool(const QVector<QString> &cells, int rowNumber, int totalRows)> RowCallback;
+
+    explicit XlsxReader(const QString &filePath);
+    ~XlsxReader();
+
+    // 映射文件、读取目录和共享字符串表，并定位第一个工作表
+    bool open();
+    void close();
+    QString errorString() const;
+
+    bool readRows(const RowCallback &callback);
+
+private:
+    XlsxReader(const XlsxReader&) = delete;
+    XlsxReader& operator=(const XlsxReader&) = delete;
+
+    struct ZipEntry {
+        quint16 method = 0;
+        quint32 compressedSize = 0;
+        quint32 uncompressedSize = 0;
+        quint32 localHeaderOffset = 0;
+    };
+
+    typedef std::function<bool(const char *data, int size)> DataSink;
+
+    bool readCentralDirectory();
+    bool readEntry(const QString &name, const DataSink &sink);
+    bool readEntryFully(const QString &name, QByteArray &data);
+    bool readSharedStrings();
+    bool locateFirstSheet();
+
+    QFile m_file;
+    uchar *m_map;
+    qint64 m_size;
+    QHash<QString, ZipEntry> m_entries;
+    QVector<QString> m_sharedStrings;
+    QString m_sheetPath;
+    QString m_error;
+};
+
+#endif // XLSXREADER_H